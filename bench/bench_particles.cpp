@@ -0,0 +1,36 @@
+// Times ParticleBuffer::Update for 100k particles. Not part of the mod build, compile it on its own
+// with the mod's include directories (shared/ and extern/includes), e.g.
+// clang++ -std=c++20 -O3 -Ishared -Iextern/includes bench/bench_particles.cpp -o bench_particles
+
+#include "ParticleBuffer.hpp"
+#include "RandomUtils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+int main() {
+    constexpr size_t Count = 100000;
+    constexpr int Frames = 200;
+
+    Sombrero::ParticleBuffer particles(Count);
+    Sombrero::RandomStream random(1);
+    auto refill = [&] {
+        while (particles.size() < Count) {
+            Sombrero::FastVector3 velocity(random.Range(-1.0f, 1.0f), random.Range(0.0f, 4.0f), random.Range(-1.0f, 1.0f));
+            particles.Emit({}, velocity, Sombrero::FastColor(1.0f, 1.0f, 1.0f, 1.0f), random.Range(1.0f, 3.0f));
+        }
+    };
+
+    double best = 1e9;
+    double total = 0.0;
+    for (int frame = 0; frame < Frames; frame++) {
+        refill();
+        auto start = std::chrono::steady_clock::now();
+        particles.Update(1.0f / 90.0f, { 0.0f, -9.81f, 0.0f }, 0.1f, Sombrero::FastColor(1.0f, 1.0f, 1.0f, 1.0f), Sombrero::FastColor(1.0f, 1.0f, 1.0f, 0.0f));
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ms);
+        total += ms;
+    }
+    std::printf("ParticleBuffer::Update, %zu particles: best %.3f ms, mean %.3f ms per frame\n", Count, best, total / Frames);
+}
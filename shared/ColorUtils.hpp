@@ -391,8 +391,7 @@ namespace std {
     {
         size_t operator()(const Sombrero::FastColor & color) const
         {
-            std::hash<float> h;
-            return h(color.r) ^ h(color.g) ^ h(color.b) ^ h(color.a);
+            return Sombrero::HashFloats(color.r, color.g, color.b, color.a);
         }
     };
 }
\ No newline at end of file
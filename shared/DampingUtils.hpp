@@ -0,0 +1,232 @@
+#pragma once
+
+#include "MiscUtils.hpp"
+#include "Vector2Utils.hpp"
+#include "Vector3Utils.hpp"
+#include "QuaternionUtils.hpp"
+#include "ColorUtils.hpp"
+
+#include <span>
+#include <limits>
+#include <type_traits>
+
+namespace Sombrero {
+
+    namespace detail {
+        template<typename T>
+        struct DampComponents;
+
+        template<> struct DampComponents<float> { constexpr static int value = 1; };
+        template<> struct DampComponents<FastVector2> { constexpr static int value = 2; };
+        template<> struct DampComponents<FastVector3> { constexpr static int value = 3; };
+        template<> struct DampComponents<FastColor> { constexpr static int value = 4; };
+        template<> struct DampComponents<FastQuaternion> { constexpr static int value = 4; };
+
+        template<typename T>
+        constexpr float& DampComponent(T& value, int i) {
+            if constexpr (std::is_same_v<T, float>) {
+                return value;
+            } else {
+                return value[i];
+            }
+        }
+
+        // Quaternions are damped as 4D vectors towards the target in the same hemisphere,
+        // the result is renormalized and the velocity kept tangent to the unit sphere
+        template<typename T>
+        constexpr T DampTarget(T const& current, T target) {
+            if constexpr (std::is_same_v<T, FastQuaternion>) {
+                if (FastQuaternion::Dot(current, target) < 0.0f) {
+                    target = FastQuaternion(-target.x, -target.y, -target.z, -target.w);
+                }
+            }
+            return target;
+        }
+
+        template<typename T>
+        inline void DampFinish(T& output, T& velocity) {
+            if constexpr (std::is_same_v<T, FastQuaternion>) {
+                output = FastQuaternion::Normalize(output);
+                float dot = FastQuaternion::Dot(velocity, output);
+                velocity = FastQuaternion(velocity.x - output.x * dot, velocity.y - output.y * dot, velocity.z - output.z * dot, velocity.w - output.w * dot);
+            }
+        }
+
+        // Unity's polynomial approximation of exp(-omega * deltaTime)
+        constexpr float SmoothDampDecay(float omega, float deltaTime) {
+            float x = omega * deltaTime;
+            return 1.0f / (1.0f + x + 0.48f * x * x + 0.235f * x * x * x);
+        }
+
+        // Same math as Unity's Mathf/Vector3.SmoothDamp with the per call constants already computed
+        template<typename T>
+        inline T SmoothDamp(T const& current, T const& rawTarget, T& velocity, float omega, float decay, float maxChange, float deltaTime) {
+            constexpr int N = DampComponents<T>::value;
+            T target = DampTarget(current, rawTarget);
+            T currentCopy = current;
+
+            float change[N];
+            float sqrChange = 0.0f;
+            for (int i = 0; i < N; i++) {
+                change[i] = DampComponent(currentCopy, i) - DampComponent(target, i);
+                sqrChange += change[i] * change[i];
+            }
+
+            // limit the speed
+            if (sqrChange > maxChange * maxChange) {
+                float scale = maxChange / std::sqrt(sqrChange);
+                for (int i = 0; i < N; i++) change[i] *= scale;
+            }
+
+            T output = target;
+            float overshoot = 0.0f;
+            for (int i = 0; i < N; i++) {
+                float& v = DampComponent(velocity, i);
+                float adjustedTarget = DampComponent(currentCopy, i) - change[i];
+                float temp = (v + omega * change[i]) * deltaTime;
+                v = (v - omega * temp) * decay;
+                float result = adjustedTarget + (change[i] + temp) * decay;
+                overshoot += (DampComponent(target, i) - DampComponent(currentCopy, i)) * (result - DampComponent(target, i));
+                DampComponent(output, i) = result;
+            }
+
+            // went past the target, snap to it
+            if (overshoot > 0.0f) {
+                output = target;
+                for (int i = 0; i < N; i++) DampComponent(velocity, i) = 0.0f;
+            }
+
+            DampFinish(output, velocity);
+            return output;
+        }
+
+        // Exact critically damped spring step, decay is exp(-omega * deltaTime)
+        template<typename T>
+        inline T SpringStep(T const& current, T const& rawTarget, T& velocity, float omega, float decay, float deltaTime) {
+            constexpr int N = DampComponents<T>::value;
+            T target = DampTarget(current, rawTarget);
+            T currentCopy = current;
+
+            T output = target;
+            for (int i = 0; i < N; i++) {
+                float& v = DampComponent(velocity, i);
+                float offset = DampComponent(currentCopy, i) - DampComponent(target, i);
+                float temp = (v + omega * offset) * deltaTime;
+                v = (v - omega * temp) * decay;
+                DampComponent(output, i) = DampComponent(target, i) + (offset + temp) * decay;
+            }
+
+            DampFinish(output, velocity);
+            return output;
+        }
+    }
+
+    template<typename T>
+    concept Dampable = requires { detail::DampComponents<T>::value; };
+
+    /// Gradually moves current towards target, like Unity's SmoothDamp.
+    /// @param velocity the current velocity, modified every call. Keep it between calls, starting from all zero components
+    /// @param smoothTime approximately how long it takes to reach the target
+    /// @param maxSpeed optionally clamps the speed
+    template<Dampable T>
+    inline T SmoothDamp(T const& current, std::type_identity_t<T> const& target, T& velocity, float smoothTime, float deltaTime, float maxSpeed = std::numeric_limits<float>::infinity()) {
+        smoothTime = std::max(0.0001f, smoothTime);
+        float omega = 2.0f / smoothTime;
+        return detail::SmoothDamp(current, target, velocity, omega, detail::SmoothDampDecay(omega, deltaTime), maxSpeed * smoothTime, deltaTime);
+    }
+
+    /// SmoothDamp for many independent values sharing the same settings, updates current and velocity in place.
+    /// All spans must be the same size
+    template<Dampable T>
+    inline void SmoothDamp(std::span<T> current, std::span<std::type_identity_t<T> const> target, std::span<T> velocity, float smoothTime, float deltaTime, float maxSpeed = std::numeric_limits<float>::infinity()) {
+        smoothTime = std::max(0.0001f, smoothTime);
+        float omega = 2.0f / smoothTime;
+        float decay = detail::SmoothDampDecay(omega, deltaTime);
+        float maxChange = maxSpeed * smoothTime;
+
+        size_t count = std::min({current.size(), target.size(), velocity.size()});
+        for (size_t i = 0; i < count; i++) {
+            current[i] = detail::SmoothDamp(current[i], target[i], velocity[i], omega, decay, maxChange, deltaTime);
+        }
+    }
+
+    /// Critically damped spring, the fastest approach to target without overshooting.
+    /// Unlike SmoothDamp this is exact for any deltaTime.
+    /// @param frequency stiffness in radians per second, it gets within 1% of a still target after about 6.6 / frequency seconds
+    template<Dampable T>
+    inline T SpringStep(T const& current, std::type_identity_t<T> const& target, T& velocity, float frequency, float deltaTime) {
+        return detail::SpringStep(current, target, velocity, frequency, std::exp(-frequency * deltaTime), deltaTime);
+    }
+
+    /// SpringStep for many independent springs sharing the same frequency, updates current and velocity in place.
+    /// All spans must be the same size
+    template<Dampable T>
+    inline void SpringStep(std::span<T> current, std::span<std::type_identity_t<T> const> target, std::span<T> velocity, float frequency, float deltaTime) {
+        float decay = std::exp(-frequency * deltaTime);
+        size_t count = std::min({current.size(), target.size(), velocity.size()});
+        for (size_t i = 0; i < count; i++) {
+            current[i] = detail::SpringStep(current[i], target[i], velocity[i], frequency, decay, deltaTime);
+        }
+    }
+
+    // Holds the state SmoothDamp needs between frames
+    template<Dampable T>
+    struct SmoothDamper {
+        T current{};
+        // FastQuaternion defaults to identity, velocities have to start at zero
+        T velocity = Zero();
+        float smoothTime = 0.1f;
+        float maxSpeed = std::numeric_limits<float>::infinity();
+
+        constexpr SmoothDamper() = default;
+        constexpr SmoothDamper(T const& current, float smoothTime, float maxSpeed = std::numeric_limits<float>::infinity()) : current(current), smoothTime(smoothTime), maxSpeed(maxSpeed) {}
+
+        T const& Update(T const& target, float deltaTime) {
+            current = SmoothDamp(current, target, velocity, smoothTime, deltaTime, maxSpeed);
+            return current;
+        }
+
+        // Jumps straight to value and stops moving
+        void Reset(T const& value) {
+            current = value;
+            velocity = Zero();
+        }
+
+    private:
+        constexpr static T Zero() {
+            T zero{};
+            for (int i = 0; i < detail::DampComponents<T>::value; i++) detail::DampComponent(zero, i) = 0.0f;
+            return zero;
+        }
+    };
+
+    // Holds the state of a critically damped spring between frames
+    template<Dampable T>
+    struct CriticallyDampedSpring {
+        T current{};
+        // FastQuaternion defaults to identity, velocities have to start at zero
+        T velocity = Zero();
+        float frequency = 10.0f;
+
+        constexpr CriticallyDampedSpring() = default;
+        constexpr CriticallyDampedSpring(T const& current, float frequency) : current(current), frequency(frequency) {}
+
+        T const& Update(T const& target, float deltaTime) {
+            current = SpringStep(current, target, velocity, frequency, deltaTime);
+            return current;
+        }
+
+        // Jumps straight to value and stops moving
+        void Reset(T const& value) {
+            current = value;
+            velocity = Zero();
+        }
+
+    private:
+        constexpr static T Zero() {
+            T zero{};
+            for (int i = 0; i < detail::DampComponents<T>::value; i++) detail::DampComponent(zero, i) = 0.0f;
+            return zero;
+        }
+    };
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include "MiscUtils.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+
+namespace Sombrero {
+
+    // std::hash run through HashMix. std::hash<int> is the identity on most standard libraries,
+    // which puts sequential keys in neighbouring slots of a power of two table
+    template<typename T>
+    struct Hash {
+        size_t operator()(T const& value) const {
+            return static_cast<size_t>(HashMix(std::hash<T>()(value)));
+        }
+    };
+
+    namespace detail {
+        // Open addressing index over a dense array of values.
+        // The values stay in insertion order in one vector. The table is a byte of control per slot
+        // (7 bits of the hash, or empty / deleted) plus the value's position, and lookups check 8 control bytes
+        // at a time with plain 64 bit integer ops, in the style of Abseil's SwissTable.
+        // A lookup then almost always compares exactly one key, whatever the probe length, so it rarely mispredicts.
+        // All three arrays come from Alloc, rebound for the control bytes and indices
+        template<typename Value, typename Key, typename KeyOf, typename HashT, typename Eq, typename Alloc>
+        class FlatTable {
+            template<typename T>
+            using Rebind = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        public:
+            using value_type = Value;
+            using allocator_type = Alloc;
+            using iterator = typename std::vector<Value, Alloc>::iterator;
+            using const_iterator = typename std::vector<Value, Alloc>::const_iterator;
+
+            FlatTable() = default;
+            explicit FlatTable(Alloc const& alloc) : values(alloc), control(alloc), indices(alloc) {}
+
+            iterator begin() { return values.begin(); }
+            iterator end() { return values.end(); }
+            const_iterator begin() const { return values.begin(); }
+            const_iterator end() const { return values.end(); }
+
+            size_t size() const {
+                return values.size();
+            }
+
+            bool empty() const {
+                return values.empty();
+            }
+
+            void clear() {
+                values.clear();
+                std::fill(control.begin(), control.end(), Empty);
+                deleted = 0;
+            }
+
+            /// Makes room for count values without growing again
+            void reserve(size_t count) {
+                values.reserve(count);
+                size_t needed = SlotCountFor(count);
+                if (needed > indices.size()) Rehash(needed);
+            }
+
+            iterator find(Key const& key) {
+                auto slot = FindSlot(key, HashOf(key));
+                return slot == NotFound ? values.end() : values.begin() + indices[slot];
+            }
+
+            const_iterator find(Key const& key) const {
+                auto slot = FindSlot(key, HashOf(key));
+                return slot == NotFound ? values.end() : values.begin() + indices[slot];
+            }
+
+            bool contains(Key const& key) const {
+                return FindSlot(key, HashOf(key)) != NotFound;
+            }
+
+            /// Removes key. The last value is moved into its place, so this changes the iteration order
+            /// @return false if key wasn't present
+            bool erase(Key const& key) {
+                size_t slot = FindSlot(key, HashOf(key));
+                if (slot == NotFound) return false;
+
+                uint32_t index = indices[slot];
+                uint32_t last = static_cast<uint32_t>(values.size() - 1);
+                if (index != last) {
+                    // point the last value's slot at the hole before moving it there.
+                    // Map keys are const, so the value is rebuilt in place rather than assigned
+                    Key const& lastKey = KeyOf()(values[last]);
+                    indices[FindSlot(lastKey, HashOf(lastKey))] = index;
+                    Alloc allocator = values.get_allocator();
+                    std::allocator_traits<Alloc>::destroy(allocator, &values[index]);
+                    std::allocator_traits<Alloc>::construct(allocator, &values[index], std::move(values[last]));
+                }
+                values.pop_back();
+                SetControl(slot, Deleted);
+                deleted++;
+                return true;
+            }
+
+        protected:
+            constexpr static uint8_t Empty = 0x80;
+            constexpr static uint8_t Deleted = 0xFE;
+            constexpr static size_t GroupWidth = 8;
+            constexpr static uint64_t LowBits = 0x0101010101010101ull;
+            constexpr static uint64_t HighBits = 0x8080808080808080ull;
+            constexpr static size_t NotFound = SIZE_MAX;
+
+            std::vector<Value, Alloc> values;
+            // one byte per slot, then a copy of the first GroupWidth bytes so a group can be read past the end
+            std::vector<uint8_t, Rebind<uint8_t>> control;
+            std::vector<uint32_t, Rebind<uint32_t>> indices;
+            size_t deleted = 0;
+            [[no_unique_address]] HashT hasher;
+            [[no_unique_address]] Eq equal;
+
+            size_t HashOf(Key const& key) const {
+                return hasher(key);
+            }
+
+            size_t Mask() const {
+                return indices.size() - 1;
+            }
+
+            // Power of two with a load factor of at most 7/8
+            static size_t SlotCountFor(size_t count) {
+                size_t needed = GroupWidth * 2;
+                while (needed * 7 < count * 8) needed *= 2;
+                return needed;
+            }
+
+            uint64_t LoadGroup(size_t slot) const {
+                uint64_t group = 0;
+                if constexpr (std::endian::native == std::endian::little) {
+                    std::memcpy(&group, control.data() + slot, sizeof(group));
+                } else {
+                    for (size_t i = 0; i < GroupWidth; i++) group |= static_cast<uint64_t>(control[slot + i]) << (i * 8);
+                }
+                return group;
+            }
+
+            // High bit of every byte equal to fingerprint. Can have rare false positives, the key compare sorts them out
+            static uint64_t MatchFingerprint(uint64_t group, uint8_t fingerprint) {
+                uint64_t x = group ^ (LowBits * fingerprint);
+                return (x - LowBits) & ~x & HighBits;
+            }
+
+            static uint64_t MatchEmpty(uint64_t group) {
+                return group & ~(group << 6) & HighBits;
+            }
+
+            static uint64_t MatchEmptyOrDeleted(uint64_t group) {
+                return group & ~(group << 7) & HighBits;
+            }
+
+            static size_t FirstByte(uint64_t mask) {
+                return static_cast<size_t>(std::countr_zero(mask)) / 8;
+            }
+
+            void SetControl(size_t slot, uint8_t value) {
+                control[slot] = value;
+                if (slot < GroupWidth) control[indices.size() + slot] = value;
+            }
+
+            size_t FindSlot(Key const& key, size_t hash) const {
+                if (indices.empty()) return NotFound;
+                auto fingerprint = static_cast<uint8_t>(hash & 0x7F);
+                // triangular steps over whole groups, which visits every group of a power of two table
+                size_t position = (hash >> 7) & Mask();
+                for (size_t step = GroupWidth;; step += GroupWidth) {
+                    uint64_t group = LoadGroup(position);
+                    for (uint64_t matches = MatchFingerprint(group, fingerprint); matches; matches &= matches - 1) {
+                        size_t slot = (position + FirstByte(matches)) & Mask();
+                        if (equal(KeyOf()(values[indices[slot]]), key)) return slot;
+                    }
+                    if (MatchEmpty(group)) return NotFound;
+                    position = (position + step) & Mask();
+                }
+            }
+
+            // First empty or deleted slot on the probe sequence for hash
+            size_t FindFreeSlot(size_t hash) const {
+                size_t position = (hash >> 7) & Mask();
+                for (size_t step = GroupWidth;; step += GroupWidth) {
+                    uint64_t free = MatchEmptyOrDeleted(LoadGroup(position));
+                    if (free) return (position + FirstByte(free)) & Mask();
+                    position = (position + step) & Mask();
+                }
+            }
+
+            // Finds key, or calls append to add its value to values and then claims a slot for it.
+            // The slot is only taken once append returned, so a throwing constructor leaves the table as it was
+            template<typename Append>
+            std::pair<size_t, bool> FindOrInsert(Key const& key, Append&& append) {
+                size_t hash = HashOf(key);
+                size_t slot = FindSlot(key, hash);
+                if (slot != NotFound) return { indices[slot], false };
+
+                if ((values.size() + deleted + 1) * 8 > indices.size() * 7) {
+                    // mostly tombstones: clean up in place, otherwise grow
+                    Rehash(values.size() * 2 < indices.size() ? indices.size() : std::max(GroupWidth * 2, indices.size() * 2));
+                }
+                slot = FindFreeSlot(hash);
+                size_t index = values.size();
+                append();
+                if (control[slot] == Deleted) deleted--;
+                SetControl(slot, static_cast<uint8_t>(hash & 0x7F));
+                indices[slot] = static_cast<uint32_t>(index);
+                return { index, true };
+            }
+
+            // Rebuilds the table from the values, which also drops every tombstone
+            void Rehash(size_t count) {
+                control.assign(count + GroupWidth, Empty);
+                indices.assign(count, 0);
+                deleted = 0;
+                for (size_t i = 0; i < values.size(); i++) {
+                    size_t hash = HashOf(KeyOf()(values[i]));
+                    size_t slot = FindFreeSlot(hash);
+                    SetControl(slot, static_cast<uint8_t>(hash & 0x7F));
+                    indices[slot] = static_cast<uint32_t>(i);
+                }
+            }
+        };
+
+        template<typename K, typename V>
+        struct PairKey {
+            K const& operator()(std::pair<K const, V> const& pair) const {
+                return pair.first;
+            }
+        };
+
+        template<typename K>
+        struct SelfKey {
+            K const& operator()(K const& key) const {
+                return key;
+            }
+        };
+    }
+
+    /// Hash map with flat storage. Iterates in insertion order until something is erased.
+    /// Entries are std::pair<K const, V> like in std::unordered_map, so a key can't be changed behind the table's back.
+    /// Three allocations no matter how many entries, plus regrowth when size isn't reserved up front
+    template<typename K, typename V, typename HashT = Hash<K>, typename Eq = std::equal_to<K>, typename Alloc = std::allocator<std::pair<K const, V>>>
+    class FlatHashMap : public detail::FlatTable<std::pair<K const, V>, K, detail::PairKey<K, V>, HashT, Eq, Alloc> {
+        using Base = detail::FlatTable<std::pair<K const, V>, K, detail::PairKey<K, V>, HashT, Eq, Alloc>;
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using typename Base::iterator;
+        using Base::Base;
+
+        /// Inserts key with a value built from args, unless key is already present
+        /// @return the entry for key and whether it was inserted
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(K const& key, Args&&... args) {
+            auto [index, inserted] = this->FindOrInsert(key, [&] {
+                this->values.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+            });
+            return { this->values.begin() + index, inserted };
+        }
+
+        /// try_emplace with the value returned by make, which is only called when key is inserted
+        template<typename F>
+        std::pair<iterator, bool> try_emplace_with(K const& key, F&& make) {
+            auto [index, inserted] = this->FindOrInsert(key, [&] {
+                this->values.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(make()));
+            });
+            return { this->values.begin() + index, inserted };
+        }
+
+        std::pair<iterator, bool> insert(std::pair<K const, V> const& pair) {
+            return try_emplace(pair.first, pair.second);
+        }
+
+        V& operator[](K const& key) {
+            return try_emplace(key).first->second;
+        }
+
+        /// @return the value for key, or nullptr
+        V* get(K const& key) {
+            auto it = this->find(key);
+            return it == this->end() ? nullptr : &it->second;
+        }
+
+        V const* get(K const& key) const {
+            auto it = this->find(key);
+            return it == this->end() ? nullptr : &it->second;
+        }
+    };
+
+    /// Hash set with flat storage, see FlatHashMap. The elements are keys, so it only hands out const iterators
+    template<typename K, typename HashT = Hash<K>, typename Eq = std::equal_to<K>, typename Alloc = std::allocator<K>>
+    class FlatHashSet : public detail::FlatTable<K, K, detail::SelfKey<K>, HashT, Eq, Alloc> {
+        using Base = detail::FlatTable<K, K, detail::SelfKey<K>, HashT, Eq, Alloc>;
+    public:
+        using key_type = K;
+        using iterator = typename Base::const_iterator;
+        using typename Base::const_iterator;
+        using Base::Base;
+
+        const_iterator begin() const { return Base::begin(); }
+        const_iterator end() const { return Base::end(); }
+
+        const_iterator find(K const& key) const {
+            return Base::find(key);
+        }
+
+        /// @return the entry for key and whether it was inserted
+        std::pair<iterator, bool> insert(K const& key) {
+            auto [index, inserted] = this->FindOrInsert(key, [&] { this->values.push_back(key); });
+            return { this->values.cbegin() + index, inserted };
+        }
+    };
+
+    namespace pmr {
+        // Tables whose storage comes from a std::pmr::memory_resource, such as a FrameArena
+        template<typename K, typename V, typename HashT = Hash<K>, typename Eq = std::equal_to<K>>
+        using FlatHashMap = Sombrero::FlatHashMap<K, V, HashT, Eq, std::pmr::polymorphic_allocator<std::pair<K const, V>>>;
+
+        template<typename K, typename HashT = Hash<K>, typename Eq = std::equal_to<K>>
+        using FlatHashSet = Sombrero::FlatHashSet<K, HashT, Eq, std::pmr::polymorphic_allocator<K>>;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace Sombrero {
+
+    // Bump allocator for data that only lives until the end of the frame, such as the results of per frame Linq queries.
+    // Allocating moves a pointer forward, deallocating does nothing and Reset frees everything at once.
+    // Memory is kept across Reset, and a frame that needed more than one block is merged into a single block on the next Reset,
+    // so once the arena has seen its largest frame it never goes back to the upstream resource.
+    // Not thread safe: give each thread its own arena.
+    class FrameArena : public std::pmr::memory_resource {
+        public:
+        explicit FrameArena(size_t initialSize = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : upstream(upstream) {
+            AddBlock(std::max<size_t>(initialSize, 1));
+        }
+
+        ~FrameArena() override {
+            ReleaseBlocks();
+        }
+
+        FrameArena(FrameArena const&) = delete;
+        FrameArena& operator=(FrameArena const&) = delete;
+
+        /// Frees everything allocated since the last Reset. Anything still pointing into the arena dangles after this
+        void Reset() {
+            if (blocks.size() > 1) {
+                // the merged block is taken first, so if upstream throws the arena still has its old blocks
+                Block merged = NewBlock(Capacity());
+                ReleaseBlocks();
+                // clear kept the capacity, this can't throw
+                blocks.push_back(merged);
+            }
+            current = 0;
+            offset = 0;
+        }
+
+        /// Bytes handed out since the last Reset, counting alignment padding and the unused ends of full blocks
+        size_t Used() const {
+            size_t used = offset;
+            for (size_t i = 0; i < current; i++) used += blocks[i].size;
+            return used;
+        }
+
+        /// Bytes reserved from upstream
+        size_t Capacity() const {
+            size_t total = 0;
+            for (auto const& block : blocks) total += block.size;
+            return total;
+        }
+
+        protected:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            while (true) {
+                Block& block = blocks[current];
+                auto base = reinterpret_cast<uintptr_t>(block.data);
+                size_t start = ((base + offset + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+                if (start + bytes <= block.size) {
+                    offset = start + bytes;
+                    return block.data + start;
+                }
+                // move on to the next block, adding one that is big enough if there is none
+                if (current + 1 == blocks.size()) AddBlock(std::max(block.size * 2, bytes + alignment));
+                current++;
+                offset = 0;
+            }
+        }
+
+        void do_deallocate(void*, size_t, size_t) override {}
+
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+            return this == &other;
+        }
+
+        private:
+        struct Block {
+            std::byte* data;
+            size_t size;
+        };
+
+        std::pmr::memory_resource* upstream;
+        std::vector<Block> blocks;
+        size_t current = 0;
+        size_t offset = 0;
+
+        Block NewBlock(size_t size) {
+            return { static_cast<std::byte*>(upstream->allocate(size, alignof(std::max_align_t))), size };
+        }
+
+        void AddBlock(size_t size) {
+            // room first, so the block can't be lost to a failing push_back
+            blocks.reserve(blocks.size() + 1);
+            blocks.push_back(NewBlock(size));
+        }
+
+        void ReleaseBlocks() {
+            for (auto const& block : blocks) upstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+            blocks.clear();
+        }
+    };
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Sombrero {
+
+    namespace detail {
+        // Keeps freed coroutine frames per thread, sorted by size, so starting a generator in a loop reuses the last frame
+        // instead of calling the heap each time. Frames over the largest class go straight to the heap
+        class FramePool {
+            public:
+            static void* Allocate(size_t size) {
+                size_t sizeClass = ClassOf(size);
+                if (sizeClass >= ClassCount) return ::operator new(size);
+                auto& list = Lists()[sizeClass];
+                if (list.head) {
+                    FreeFrame* frame = list.head;
+                    list.head = frame->next;
+                    list.count--;
+                    return frame;
+                }
+                return ::operator new((sizeClass + 1) * Granularity);
+            }
+
+            static void Free(void* pointer, size_t size) {
+                size_t sizeClass = ClassOf(size);
+                if (sizeClass >= ClassCount) {
+                    ::operator delete(pointer);
+                    return;
+                }
+                auto& list = Lists()[sizeClass];
+                if (list.count == MaxCached) {
+                    ::operator delete(pointer);
+                    return;
+                }
+                list.head = new (pointer) FreeFrame{ list.head };
+                list.count++;
+            }
+
+            private:
+            constexpr static size_t Granularity = 64;
+            constexpr static size_t ClassCount = 16;
+            // frames kept per class, more than this many generators alive at once on one thread is rare
+            constexpr static size_t MaxCached = 32;
+
+            struct FreeFrame {
+                FreeFrame* next;
+            };
+
+            struct FreeList {
+                FreeFrame* head = nullptr;
+                size_t count = 0;
+
+                ~FreeList() {
+                    while (head) {
+                        FreeFrame* next = head->next;
+                        ::operator delete(head);
+                        head = next;
+                    }
+                }
+            };
+
+            static size_t ClassOf(size_t size) {
+                return (size - 1) / Granularity;
+            }
+
+            static std::array<FreeList, ClassCount>& Lists() {
+                thread_local std::array<FreeList, ClassCount> lists;
+                return lists;
+            }
+        };
+    }
+
+    /**
+     * Lazy sequence written as a coroutine with co_yield. Nothing runs until it is iterated, and each step runs the body
+     * up to the next co_yield, so it can be put in front of Linq operators without building a vector first.
+     * co_yield another Generator<T> (as an rvalue) to yield everything it yields. Control passes straight between the frames,
+     * so nesting depth doesn't add to the stack.
+     * An exception that escapes the body comes out of begin() or the iterator's ++. From a nested generator it comes out of
+     * the co_yield that started it first, so the outer body can catch it.
+     * Single pass: begin() can only be called once. Frames come from a per thread pool
+     */
+    template<typename T>
+    class Generator {
+        public:
+        struct promise_type;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        struct promise_type {
+            T const* value = nullptr;
+            // outermost generator, the one being iterated, and on it the innermost one currently running
+            promise_type* root = this;
+            promise_type* leaf = this;
+            // generator that yielded this one, nullptr for the outermost
+            promise_type* parent = nullptr;
+            // what escaped the body, rethrown to the parent's co_yield or to whoever is iterating
+            std::exception_ptr exception;
+
+            Generator get_return_object() {
+                return Generator(handle_type::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+
+            // Hands control back to the generator that yielded this one, or to whoever is iterating
+            struct FinalAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+                std::coroutine_handle<> await_suspend(handle_type handle) noexcept {
+                    promise_type& promise = handle.promise();
+                    if (!promise.parent) return std::noop_coroutine();
+                    promise.root->leaf = promise.parent;
+                    return handle_type::from_promise(*promise.parent);
+                }
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept {
+                return {};
+            }
+
+            // the yielded value outlives the suspension, it is only destroyed once the body resumes
+            std::suspend_always yield_value(T const& item) noexcept {
+                value = std::addressof(item);
+                return {};
+            }
+
+            std::suspend_always yield_value(T&& item) noexcept {
+                value = std::addressof(item);
+                return {};
+            }
+
+            // Runs inner until it finishes, with its values going straight to whoever iterates the outermost generator
+            struct NestedAwaiter {
+                Generator inner;
+
+                bool await_ready() noexcept {
+                    return !inner.handle || inner.handle.done();
+                }
+                std::coroutine_handle<> await_suspend(handle_type handle) noexcept {
+                    promise_type& outer = handle.promise();
+                    promise_type& promise = inner.handle.promise();
+                    promise.root = outer.root;
+                    promise.parent = &outer;
+                    outer.root->leaf = &promise;
+                    return inner.handle;
+                }
+                void await_resume() {
+                    if (inner.handle && inner.handle.promise().exception) std::rethrow_exception(inner.handle.promise().exception);
+                }
+            };
+
+            NestedAwaiter yield_value(Generator&& inner) noexcept {
+                return NestedAwaiter{ std::move(inner) };
+            }
+
+            void return_void() noexcept {}
+
+            // the body is done now, final_suspend passes control on to where this gets rethrown
+            void unhandled_exception() noexcept {
+                exception = std::current_exception();
+            }
+
+            static void* operator new(size_t size) {
+                return detail::FramePool::Allocate(size);
+            }
+
+            static void operator delete(void* pointer, size_t size) {
+                detail::FramePool::Free(pointer, size);
+            }
+        };
+
+        struct Iterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = std::remove_cv_t<T>;
+            using pointer = T const*;
+            using reference = T const&;
+            using iterator_category = std::input_iterator_tag;
+
+            Iterator() = default;
+            explicit Iterator(handle_type handle) : handle(handle) {}
+
+            reference operator*() const {
+                return *handle.promise().leaf->value;
+            }
+            pointer operator->() const {
+                return handle.promise().leaf->value;
+            }
+            Iterator& operator++() {
+                handle_type::from_promise(*handle.promise().leaf).resume();
+                Rethrow(handle);
+                return *this;
+            }
+            void operator++(int) {
+                ++*this;
+            }
+            // an Iterator is either running or at the end, end() is an Iterator without a coroutine
+            bool operator==(Iterator const& other) const {
+                return Done() == other.Done();
+            }
+
+            private:
+            handle_type handle = nullptr;
+
+            bool Done() const {
+                return !handle || handle.done();
+            }
+        };
+
+        using iterator = Iterator;
+        using value_type = std::remove_cv_t<T>;
+
+        Generator() = default;
+
+        Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+        Generator& operator=(Generator&& other) noexcept {
+            if (this != &other) {
+                if (handle) handle.destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Generator() {
+            if (handle) handle.destroy();
+        }
+
+        /// Starts the body and runs it to the first co_yield
+        Iterator begin() const {
+            if (!handle) return Iterator();
+            handle.resume();
+            Rethrow(handle);
+            return Iterator(handle);
+        }
+
+        Iterator end() const {
+            return Iterator();
+        }
+
+        private:
+        handle_type handle = nullptr;
+
+        explicit Generator(handle_type handle) : handle(handle) {}
+
+        // An exception that reached the outermost body, which is finished after it
+        static void Rethrow(handle_type root) {
+            if (root.promise().exception) std::rethrow_exception(std::exchange(root.promise().exception, nullptr));
+        }
+    };
+}
@@ -5,6 +5,9 @@
 #include <concepts>
 #include <cmath>
 #include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
 #include "Concepts.hpp"
 
 #ifdef SOMBRERO_DEBUG
@@ -78,6 +81,34 @@ namespace Sombrero {
             : std::numeric_limits<float>::quiet_NaN();
     }
 
+    // Finalizer from MurmurHash3. Every input bit affects every output bit,
+    // which hash tables that mask off the low bits need
+    constexpr uint64_t HashMix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Order matters, so HashCombine(HashCombine(0, a), b) differs from the reverse
+    constexpr size_t HashCombine(size_t seed, size_t value) {
+        return static_cast<size_t>(HashMix(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2))));
+    }
+
+    // 0.0f and -0.0f compare equal, so they have to hash the same
+    constexpr size_t HashFloat(float value) {
+        return value == 0.0f ? 0 : std::bit_cast<uint32_t>(value);
+    }
+
+    template<std::same_as<float>... Floats>
+    constexpr size_t HashFloats(Floats... values) {
+        size_t seed = 0;
+        ((seed = HashCombine(seed, HashFloat(values))), ...);
+        return seed;
+    }
+
     // Convert degrees to radians
     constexpr double degreesToRadians(double degrees) {
       return degrees * M_PI / 180.0;
@@ -0,0 +1,415 @@
+#pragma once
+
+#include "Vector3Utils.hpp"
+#include "QuaternionUtils.hpp"
+
+#include <span>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Binary recording format for FastVector3/FastQuaternion motion (replays, motion capture).
+//
+// File layout, little endian:
+//   MotionStreamHeader
+//   chunk*   each one is a MotionChunkHeader followed by its payload
+//
+// A chunk payload holds frameCount float timestamps, then one stream per channel, vectors first.
+// Channel values are quantized (positions to the header precision, rotation components to 1/32767)
+// and stored as zigzag varint deltas from the previous frame, each chunk restarting from zero so it decodes on its own.
+// Chunks are only ever appended, a recording cut short by a crash just loses its last partial chunk.
+namespace Sombrero {
+
+    struct MotionStreamHeader {
+        char magic[4] = {'S', 'M', 'O', 'T'};
+        uint32_t version = 1;
+        uint32_t vectorChannels = 0;
+        uint32_t rotationChannels = 0;
+        // positions are stored as multiples of this
+        float positionPrecision = 0.0001f;
+    };
+
+    struct MotionChunkHeader {
+        char magic[4] = {'C', 'H', 'N', 'K'};
+        uint32_t frameCount = 0;
+        uint32_t payloadSize = 0;
+        float startTime = 0.0f;
+        float endTime = 0.0f;
+    };
+
+    namespace detail {
+        constexpr float RotationPrecision = 32767.0f;
+
+        constexpr uint32_t ZigZag(int32_t value) {
+            return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        }
+
+        constexpr int32_t UnZigZag(uint32_t value) {
+            return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+
+        inline void WriteVarint(std::vector<uint8_t>& out, uint32_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<uint8_t>(value) | 0x80);
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        // Returns nullptr if the varint runs past end
+        inline uint8_t const* ReadVarint(uint8_t const* data, uint8_t const* end, uint32_t& value) {
+            value = 0;
+            for (int shift = 0; shift < 35 && data < end; shift += 7) {
+                uint8_t byte = *data++;
+                value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) return data;
+            }
+            return nullptr;
+        }
+
+        inline int32_t QuantizeMotion(float value, float inversePrecision) {
+            return static_cast<int32_t>(std::lround(value * inversePrecision));
+        }
+
+        // Delta encodes one channel for all frames, values holds Components floats per frame
+        template<int Components>
+        inline void EncodeChannel(std::vector<uint8_t>& out, float const* values, size_t frameCount, float inversePrecision) {
+            int32_t previous[Components] = {};
+            for (size_t frame = 0; frame < frameCount; frame++) {
+                for (int c = 0; c < Components; c++) {
+                    int32_t quantized = QuantizeMotion(values[frame * Components + c], inversePrecision);
+                    WriteVarint(out, ZigZag(quantized - previous[c]));
+                    previous[c] = quantized;
+                }
+            }
+        }
+
+        // Decodes frames [0, skip + count) but only writes the last count of them
+        template<int Components>
+        inline uint8_t const* DecodeChannel(uint8_t const* data, uint8_t const* end, size_t skip, size_t count, float* out, float precision) {
+            int32_t current[Components] = {};
+            for (size_t frame = 0; frame < skip + count; frame++) {
+                for (int c = 0; c < Components; c++) {
+                    uint32_t raw;
+                    data = ReadVarint(data, end, raw);
+                    if (!data) return nullptr;
+                    current[c] += UnZigZag(raw);
+                }
+                if (frame >= skip) {
+                    for (int c = 0; c < Components; c++) {
+                        out[(frame - skip) * Components + c] = static_cast<float>(current[c]) * precision;
+                    }
+                }
+            }
+            return data;
+        }
+
+        // Skips a channel stream without decoding values
+        inline uint8_t const* SkipChannel(uint8_t const* data, uint8_t const* end, size_t varints) {
+            for (size_t i = 0; i < varints; i++) {
+                uint32_t raw;
+                data = ReadVarint(data, end, raw);
+                if (!data) return nullptr;
+            }
+            return data;
+        }
+    }
+
+    // Appends frames to a motion stream file, one chunk at a time
+    class MotionStreamWriter {
+    public:
+        /// Creates (or truncates) path and writes the header
+        /// @param framesPerChunk frames buffered before a chunk is encoded and written, which is also the random access granularity
+        MotionStreamWriter(std::string const& path, uint32_t vectorChannels, uint32_t rotationChannels, float positionPrecision = 0.0001f, uint32_t framesPerChunk = 256) :
+            framesPerChunk(std::max(framesPerChunk, 1u))
+        {
+            header.vectorChannels = vectorChannels;
+            header.rotationChannels = rotationChannels;
+            header.positionPrecision = positionPrecision;
+
+            file = std::fopen(path.c_str(), "wb");
+            if (file && std::fwrite(&header, sizeof(header), 1, file) != 1) Close();
+
+            times.reserve(this->framesPerChunk);
+            vectors.resize(vectorChannels);
+            rotations.resize(rotationChannels);
+            for (auto& channel : vectors) channel.reserve(this->framesPerChunk);
+            for (auto& channel : rotations) channel.reserve(this->framesPerChunk);
+        }
+
+        MotionStreamWriter(MotionStreamWriter const&) = delete;
+        MotionStreamWriter& operator=(MotionStreamWriter const&) = delete;
+
+        ~MotionStreamWriter() {
+            Close();
+        }
+
+        bool IsOpen() const {
+            return file != nullptr;
+        }
+
+        /// Adds one frame. Spans must hold exactly one value per channel
+        /// @return false if the file isn't open or the spans have the wrong size
+        bool WriteFrame(float time, std::span<FastVector3 const> frameVectors, std::span<FastQuaternion const> frameRotations) {
+            if (!file || frameVectors.size() != header.vectorChannels || frameRotations.size() != header.rotationChannels) return false;
+
+            times.push_back(time);
+            for (size_t c = 0; c < frameVectors.size(); c++) {
+                vectors[c].push_back(frameVectors[c]);
+            }
+            for (size_t c = 0; c < frameRotations.size(); c++) {
+                rotations[c].push_back(frameRotations[c]);
+            }
+
+            if (times.size() >= framesPerChunk) return Flush();
+            return true;
+        }
+
+        /// Writes buffered frames as a chunk even if it isn't full
+        bool Flush() {
+            if (!file) return false;
+            if (times.empty()) return true;
+
+            payload.clear();
+            payload.resize(times.size() * sizeof(float));
+            std::memcpy(payload.data(), times.data(), payload.size());
+
+            float inversePrecision = 1.0f / header.positionPrecision;
+            for (auto const& channel : vectors) {
+                detail::EncodeChannel<3>(payload, reinterpret_cast<float const*>(channel.data()), channel.size(), inversePrecision);
+            }
+            for (auto const& channel : rotations) {
+                detail::EncodeChannel<4>(payload, reinterpret_cast<float const*>(channel.data()), channel.size(), detail::RotationPrecision);
+            }
+
+            MotionChunkHeader chunk;
+            chunk.frameCount = static_cast<uint32_t>(times.size());
+            chunk.payloadSize = static_cast<uint32_t>(payload.size());
+            chunk.startTime = times.front();
+            chunk.endTime = times.back();
+
+            bool ok = std::fwrite(&chunk, sizeof(chunk), 1, file) == 1 &&
+                      std::fwrite(payload.data(), 1, payload.size(), file) == payload.size() &&
+                      std::fflush(file) == 0;
+
+            times.clear();
+            for (auto& channel : vectors) channel.clear();
+            for (auto& channel : rotations) channel.clear();
+            return ok;
+        }
+
+        /// Flushes and closes the file
+        void Close() {
+            if (!file) return;
+            Flush();
+            std::fclose(file);
+            file = nullptr;
+        }
+
+    private:
+        static_assert(sizeof(FastVector3) == sizeof(float) * 3 && sizeof(FastQuaternion) == sizeof(float) * 4);
+
+        std::FILE* file = nullptr;
+        MotionStreamHeader header;
+        uint32_t framesPerChunk;
+
+        // current chunk, reused between chunks
+        std::vector<float> times;
+        std::vector<std::vector<FastVector3>> vectors;
+        std::vector<std::vector<FastQuaternion>> rotations;
+        std::vector<uint8_t> payload;
+    };
+
+    // Memory maps a motion stream and decodes frame ranges on demand.
+    // Opening only walks the chunk headers, payloads are paged in by the OS as they're read
+    // so memory use depends on what is decoded, not on the file length.
+    class MotionStreamReader {
+    public:
+        explicit MotionStreamReader(std::string const& path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+
+            struct stat info{};
+            if (::fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(MotionStreamHeader))) {
+                void* mapped = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    data = static_cast<uint8_t const*>(mapped);
+                    size = static_cast<size_t>(info.st_size);
+                }
+            }
+            // the mapping stays valid after closing
+            ::close(fd);
+
+            if (data && !Index()) Unmap();
+        }
+
+        MotionStreamReader(MotionStreamReader const&) = delete;
+        MotionStreamReader& operator=(MotionStreamReader const&) = delete;
+
+        ~MotionStreamReader() {
+            Unmap();
+        }
+
+        bool IsOpen() const {
+            return data != nullptr;
+        }
+
+        MotionStreamHeader const& GetHeader() const {
+            return header;
+        }
+
+        size_t GetFrameCount() const {
+            return chunks.empty() ? 0 : chunks.back().firstFrame + chunks.back().frameCount;
+        }
+
+        float GetStartTime() const {
+            return chunks.empty() ? 0.0f : chunks.front().startTime;
+        }
+
+        float GetEndTime() const {
+            return chunks.empty() ? 0.0f : chunks.back().endTime;
+        }
+
+        /// Index of the first frame with a timestamp >= time, or GetFrameCount() if there is none
+        size_t FindFrame(float time) const {
+            auto chunk = std::lower_bound(chunks.begin(), chunks.end(), time, [](ChunkInfo const& info, float t) { return info.endTime < t; });
+            if (chunk == chunks.end()) return GetFrameCount();
+
+            for (uint32_t i = 0; i < chunk->frameCount; i++) {
+                if (ReadTime(*chunk, i) >= time) return chunk->firstFrame + i;
+            }
+            return chunk->firstFrame + chunk->frameCount;
+        }
+
+        /// Decodes frames [firstFrame, firstFrame + count) into structure of arrays outputs.
+        /// Channels are laid out one after the other: channel c of frame f lands at [c * count + f].
+        /// Any output span may be empty to skip decoding it, otherwise it needs room for every channel.
+        /// @return how many frames were decoded, less than count if the range runs past the end or the file is damaged
+        size_t Decode(size_t firstFrame, size_t count, std::span<float> outTimes, std::span<FastVector3> outVectors, std::span<FastQuaternion> outRotations) const {
+            size_t frameCount = GetFrameCount();
+            if (firstFrame >= frameCount) return 0;
+            count = std::min(count, frameCount - firstFrame);
+
+            bool wantTimes = !outTimes.empty();
+            bool wantVectors = !outVectors.empty();
+            bool wantRotations = !outRotations.empty();
+            if ((wantTimes && outTimes.size() < count) ||
+                (wantVectors && outVectors.size() < count * header.vectorChannels) ||
+                (wantRotations && outRotations.size() < count * header.rotationChannels)) return 0;
+
+            auto chunk = std::upper_bound(chunks.begin(), chunks.end(), firstFrame, [](size_t frame, ChunkInfo const& info) { return frame < info.firstFrame; }) - 1;
+
+            size_t done = 0;
+            for (; chunk != chunks.end() && done < count; ++chunk) {
+                size_t skip = firstFrame + done - chunk->firstFrame;
+                size_t take = std::min<size_t>(chunk->frameCount - skip, count - done);
+                if (!DecodeChunk(*chunk, skip, take, done, count, outTimes, outVectors, outRotations, wantTimes, wantVectors, wantRotations)) break;
+                done += take;
+            }
+            return done;
+        }
+
+        /// Decode for every frame with startTime <= time < endTime. The outputs are resized to fit
+        size_t DecodeTimeRange(float startTime, float endTime, std::vector<float>& outTimes, std::vector<FastVector3>& outVectors, std::vector<FastQuaternion>& outRotations) const {
+            size_t first = FindFrame(startTime);
+            size_t last = FindFrame(endTime);
+            size_t count = last > first ? last - first : 0;
+
+            outTimes.resize(count);
+            outVectors.resize(count * header.vectorChannels);
+            outRotations.resize(count * header.rotationChannels);
+            if (count == 0) return 0;
+            return Decode(first, count, outTimes, outVectors, outRotations);
+        }
+
+    private:
+        struct ChunkInfo {
+            size_t offset;
+            size_t firstFrame;
+            uint32_t frameCount;
+            uint32_t payloadSize;
+            float startTime;
+            float endTime;
+        };
+
+        uint8_t const* data = nullptr;
+        size_t size = 0;
+        MotionStreamHeader header;
+        std::vector<ChunkInfo> chunks;
+
+        void Unmap() {
+            if (data) ::munmap(const_cast<uint8_t*>(data), size);
+            data = nullptr;
+            size = 0;
+            chunks.clear();
+        }
+
+        bool Index() {
+            std::memcpy(&header, data, sizeof(header));
+            if (std::memcmp(header.magic, MotionStreamHeader().magic, 4) != 0 || header.version != 1 || header.positionPrecision <= 0.0f) return false;
+
+            size_t offset = sizeof(header);
+            size_t frames = 0;
+            while (offset + sizeof(MotionChunkHeader) <= size) {
+                MotionChunkHeader chunk;
+                std::memcpy(&chunk, data + offset, sizeof(chunk));
+                size_t payloadStart = offset + sizeof(chunk);
+                // stop at a damaged or partially written chunk
+                if (std::memcmp(chunk.magic, MotionChunkHeader().magic, 4) != 0 || chunk.payloadSize > size - payloadStart || chunk.frameCount == 0) break;
+
+                chunks.push_back({payloadStart, frames, chunk.frameCount, chunk.payloadSize, chunk.startTime, chunk.endTime});
+                frames += chunk.frameCount;
+                offset = payloadStart + chunk.payloadSize;
+            }
+            return true;
+        }
+
+        float ReadTime(ChunkInfo const& chunk, size_t frame) const {
+            float time;
+            std::memcpy(&time, data + chunk.offset + frame * sizeof(float), sizeof(float));
+            return time;
+        }
+
+        bool DecodeChunk(ChunkInfo const& chunk, size_t skip, size_t take, size_t outOffset, size_t outStride,
+                         std::span<float> outTimes, std::span<FastVector3> outVectors, std::span<FastQuaternion> outRotations,
+                         bool wantTimes, bool wantVectors, bool wantRotations) const {
+            uint8_t const* cursor = data + chunk.offset;
+            uint8_t const* end = cursor + chunk.payloadSize;
+            if (chunk.payloadSize < chunk.frameCount * sizeof(float)) return false;
+
+            if (wantTimes) {
+                std::memcpy(outTimes.data() + outOffset, cursor + skip * sizeof(float), take * sizeof(float));
+            }
+            cursor += chunk.frameCount * sizeof(float);
+
+            for (uint32_t c = 0; c < header.vectorChannels && cursor; c++) {
+                if (wantVectors) {
+                    float* out = reinterpret_cast<float*>(outVectors.data() + c * outStride + outOffset);
+                    cursor = detail::DecodeChannel<3>(cursor, end, skip, take, out, header.positionPrecision);
+                    if (cursor) cursor = detail::SkipChannel(cursor, end, (chunk.frameCount - skip - take) * 3);
+                } else {
+                    cursor = detail::SkipChannel(cursor, end, static_cast<size_t>(chunk.frameCount) * 3);
+                }
+            }
+
+            if (wantRotations) {
+                for (uint32_t c = 0; c < header.rotationChannels && cursor; c++) {
+                    FastQuaternion* out = outRotations.data() + c * outStride + outOffset;
+                    cursor = detail::DecodeChannel<4>(cursor, end, skip, take, reinterpret_cast<float*>(out), 1.0f / detail::RotationPrecision);
+                    if (cursor) cursor = detail::SkipChannel(cursor, end, (chunk.frameCount - skip - take) * 4);
+                    // undo the quantization drift
+                    for (size_t i = 0; i < take; i++) out[i] = FastQuaternion::Normalize(out[i]);
+                }
+            }
+            return cursor != nullptr;
+        }
+    };
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "MiscUtils.hpp"
+#include "Vector2Utils.hpp"
+#include "Vector3Utils.hpp"
+
+#include <span>
+#include <cstdint>
+#include <algorithm>
+
+namespace Sombrero {
+
+    enum class NoiseType {
+        Value,
+        Perlin,
+        Simplex
+    };
+
+    // Deterministic gradient noise. The same seed and point always give the same value, on any thread.
+    // Lattice points are hashed arithmetically instead of through a permutation table,
+    // so the batch overloads don't gather from memory and the compiler can vectorize across points.
+    // Every function returns roughly [-1, 1].
+    class Noise {
+    public:
+        uint32_t seed;
+
+        constexpr explicit Noise(uint32_t seed = 0) : seed(seed) {}
+
+        // Value noise, smoothly interpolated random values at integer coordinates
+
+        constexpr float Value(float x) const {
+            int32_t x0 = FastFloor(x);
+            float u = Fade(x - static_cast<float>(x0));
+            return Mix(LatticeValue(Hash(x0, 0, 0)), LatticeValue(Hash(x0 + 1, 0, 0)), u);
+        }
+
+        constexpr float Value(FastVector2 const& point) const {
+            int32_t x0 = FastFloor(point.x), y0 = FastFloor(point.y);
+            float u = Fade(point.x - static_cast<float>(x0)), v = Fade(point.y - static_cast<float>(y0));
+            return Mix(Mix(LatticeValue(Hash(x0, y0, 0)), LatticeValue(Hash(x0 + 1, y0, 0)), u),
+                       Mix(LatticeValue(Hash(x0, y0 + 1, 0)), LatticeValue(Hash(x0 + 1, y0 + 1, 0)), u), v);
+        }
+
+        constexpr float Value(FastVector3 const& point) const {
+            int32_t x0 = FastFloor(point.x), y0 = FastFloor(point.y), z0 = FastFloor(point.z);
+            float u = Fade(point.x - static_cast<float>(x0)), v = Fade(point.y - static_cast<float>(y0)), w = Fade(point.z - static_cast<float>(z0));
+            float near = Mix(Mix(LatticeValue(Hash(x0, y0, z0)), LatticeValue(Hash(x0 + 1, y0, z0)), u),
+                             Mix(LatticeValue(Hash(x0, y0 + 1, z0)), LatticeValue(Hash(x0 + 1, y0 + 1, z0)), u), v);
+            float far = Mix(Mix(LatticeValue(Hash(x0, y0, z0 + 1)), LatticeValue(Hash(x0 + 1, y0, z0 + 1)), u),
+                            Mix(LatticeValue(Hash(x0, y0 + 1, z0 + 1)), LatticeValue(Hash(x0 + 1, y0 + 1, z0 + 1)), u), v);
+            return Mix(near, far, w);
+        }
+
+        // Ken Perlin's improved noise, random gradients at integer coordinates
+
+        constexpr float Perlin(float x) const {
+            int32_t x0 = FastFloor(x);
+            float fx = x - static_cast<float>(x0);
+            float n0 = Gradient(Hash(x0, 0, 0), fx);
+            float n1 = Gradient(Hash(x0 + 1, 0, 0), fx - 1.0f);
+            return Mix(n0, n1, Fade(fx)) * 2.0f;
+        }
+
+        constexpr float Perlin(FastVector2 const& point) const {
+            int32_t x0 = FastFloor(point.x), y0 = FastFloor(point.y);
+            float fx = point.x - static_cast<float>(x0), fy = point.y - static_cast<float>(y0);
+            float u = Fade(fx), v = Fade(fy);
+            float n00 = Gradient(Hash(x0, y0, 0), fx, fy);
+            float n10 = Gradient(Hash(x0 + 1, y0, 0), fx - 1.0f, fy);
+            float n01 = Gradient(Hash(x0, y0 + 1, 0), fx, fy - 1.0f);
+            float n11 = Gradient(Hash(x0 + 1, y0 + 1, 0), fx - 1.0f, fy - 1.0f);
+            // the (1, 2) gradients reach about 1.5, scale back to [-1, 1]
+            return Mix(Mix(n00, n10, u), Mix(n01, n11, u), v) * 0.66f;
+        }
+
+        constexpr float Perlin(FastVector3 const& point) const {
+            int32_t x0 = FastFloor(point.x), y0 = FastFloor(point.y), z0 = FastFloor(point.z);
+            float fx = point.x - static_cast<float>(x0), fy = point.y - static_cast<float>(y0), fz = point.z - static_cast<float>(z0);
+            float u = Fade(fx), v = Fade(fy), w = Fade(fz);
+            float near = Mix(Mix(Gradient(Hash(x0, y0, z0), fx, fy, fz), Gradient(Hash(x0 + 1, y0, z0), fx - 1.0f, fy, fz), u),
+                             Mix(Gradient(Hash(x0, y0 + 1, z0), fx, fy - 1.0f, fz), Gradient(Hash(x0 + 1, y0 + 1, z0), fx - 1.0f, fy - 1.0f, fz), u), v);
+            float far = Mix(Mix(Gradient(Hash(x0, y0, z0 + 1), fx, fy, fz - 1.0f), Gradient(Hash(x0 + 1, y0, z0 + 1), fx - 1.0f, fy, fz - 1.0f), u),
+                            Mix(Gradient(Hash(x0, y0 + 1, z0 + 1), fx, fy - 1.0f, fz - 1.0f), Gradient(Hash(x0 + 1, y0 + 1, z0 + 1), fx - 1.0f, fy - 1.0f, fz - 1.0f), u), v);
+            return Mix(near, far, w);
+        }
+
+        // Simplex noise (Gustavson's formulation), fewer lattice points than Perlin and no axis aligned artifacts
+
+        constexpr float Simplex(float x) const {
+            int32_t i0 = FastFloor(x);
+            float x0 = x - static_cast<float>(i0);
+            float x1 = x0 - 1.0f;
+            float t0 = 1.0f - x0 * x0;
+            float t1 = 1.0f - x1 * x1;
+            t0 *= t0;
+            t1 *= t1;
+            return 0.395f * (t0 * t0 * SimplexGradient(Hash(i0, 0, 0), x0) + t1 * t1 * SimplexGradient(Hash(i0 + 1, 0, 0), x1));
+        }
+
+        constexpr float Simplex(FastVector2 const& point) const {
+            constexpr float F2 = 0.366025403f; // (sqrt(3) - 1) / 2
+            constexpr float G2 = 0.211324865f; // (3 - sqrt(3)) / 6
+
+            float s = (point.x + point.y) * F2;
+            int32_t i = FastFloor(point.x + s), j = FastFloor(point.y + s);
+            float t = static_cast<float>(i + j) * G2;
+            float x0 = point.x - (static_cast<float>(i) - t);
+            float y0 = point.y - (static_cast<float>(j) - t);
+
+            // which triangle of the skewed cell we're in
+            auto i1 = static_cast<int32_t>(x0 > y0);
+            int32_t j1 = 1 - i1;
+
+            float x1 = x0 - static_cast<float>(i1) + G2, y1 = y0 - static_cast<float>(j1) + G2;
+            float x2 = x0 - 1.0f + 2.0f * G2, y2 = y0 - 1.0f + 2.0f * G2;
+
+            float n = SimplexCorner(0.5f - x0 * x0 - y0 * y0, Gradient(Hash(i, j, 0), x0, y0))
+                    + SimplexCorner(0.5f - x1 * x1 - y1 * y1, Gradient(Hash(i + i1, j + j1, 0), x1, y1))
+                    + SimplexCorner(0.5f - x2 * x2 - y2 * y2, Gradient(Hash(i + 1, j + 1, 0), x2, y2));
+            return 40.0f * n;
+        }
+
+        constexpr float Simplex(FastVector3 const& point) const {
+            constexpr float F3 = 1.0f / 3.0f;
+            constexpr float G3 = 1.0f / 6.0f;
+
+            float s = (point.x + point.y + point.z) * F3;
+            int32_t i = FastFloor(point.x + s), j = FastFloor(point.y + s), k = FastFloor(point.z + s);
+            float t = static_cast<float>(i + j + k) * G3;
+            float x0 = point.x - (static_cast<float>(i) - t);
+            float y0 = point.y - (static_cast<float>(j) - t);
+            float z0 = point.z - (static_cast<float>(k) - t);
+
+            // which of the six tetrahedra we're in, written without branches
+            int32_t xy = x0 >= y0, xz = x0 >= z0, yz = y0 >= z0;
+            int32_t i1 = xy & xz, j1 = (1 - xy) & yz, k1 = (1 - xz) & (1 - yz);
+            int32_t i2 = xy | xz, j2 = (1 - xy) | yz, k2 = (1 - xz) | (1 - yz);
+
+            float x1 = x0 - static_cast<float>(i1) + G3, y1 = y0 - static_cast<float>(j1) + G3, z1 = z0 - static_cast<float>(k1) + G3;
+            float x2 = x0 - static_cast<float>(i2) + 2.0f * G3, y2 = y0 - static_cast<float>(j2) + 2.0f * G3, z2 = z0 - static_cast<float>(k2) + 2.0f * G3;
+            float x3 = x0 - 1.0f + 3.0f * G3, y3 = y0 - 1.0f + 3.0f * G3, z3 = z0 - 1.0f + 3.0f * G3;
+
+            float n = SimplexCorner(0.6f - x0 * x0 - y0 * y0 - z0 * z0, Gradient(Hash(i, j, k), x0, y0, z0))
+                    + SimplexCorner(0.6f - x1 * x1 - y1 * y1 - z1 * z1, Gradient(Hash(i + i1, j + j1, k + k1), x1, y1, z1))
+                    + SimplexCorner(0.6f - x2 * x2 - y2 * y2 - z2 * z2, Gradient(Hash(i + i2, j + j2, k + k2), x2, y2, z2))
+                    + SimplexCorner(0.6f - x3 * x3 - y3 * y3 - z3 * z3, Gradient(Hash(i + 1, j + 1, k + 1), x3, y3, z3));
+            return 32.0f * n;
+        }
+
+        template<typename P>
+        constexpr float Sample(NoiseType type, P const& point) const {
+            switch (type) {
+                case NoiseType::Value: return Value(point);
+                case NoiseType::Perlin: return Perlin(point);
+                default: return Simplex(point);
+            }
+        }
+
+        /// Fractal Brownian motion, octaves of noise each at lacunarity times the frequency and gain times the amplitude.
+        /// Normalized back to roughly [-1, 1]
+        template<typename P>
+        constexpr float Fractal(NoiseType type, P const& point, int octaves = 4, float lacunarity = 2.0f, float gain = 0.5f) const {
+            float sum = 0.0f, amplitude = 1.0f, frequency = 1.0f, total = 0.0f;
+            for (int octave = 0; octave < octaves; octave++) {
+                // each octave gets its own seed so the lattices don't line up at the origin
+                sum += Noise(seed + static_cast<uint32_t>(octave)).Sample(type, point * frequency) * amplitude;
+                total += amplitude;
+                amplitude *= gain;
+                frequency *= lacunarity;
+            }
+            // multiply by the inverse like the batch version so both give identical results
+            return total > 0.0f ? sum * (1.0f / total) : 0.0f;
+        }
+
+        /// Samples every point, out must be at least as big as points.
+        /// The noise type is resolved once, so the loop body is straight line code
+        template<typename P>
+        void Sample(NoiseType type, std::span<P const> points, std::span<float> out) const {
+            switch (type) {
+                case NoiseType::Value: return Fill(points, out, [this](P const& p) { return Value(p); });
+                case NoiseType::Perlin: return Fill(points, out, [this](P const& p) { return Perlin(p); });
+                default: return Fill(points, out, [this](P const& p) { return Simplex(p); });
+            }
+        }
+
+        /// Batch Fractal, octaves are the outer loop so each pass is one simple loop over all points
+        template<typename P>
+        void Fractal(NoiseType type, std::span<P const> points, std::span<float> out, int octaves = 4, float lacunarity = 2.0f, float gain = 0.5f) const {
+            size_t count = std::min(points.size(), out.size());
+            std::fill_n(out.begin(), count, 0.0f);
+
+            float amplitude = 1.0f, frequency = 1.0f, total = 0.0f;
+            for (int octave = 0; octave < octaves; octave++) {
+                Noise layer(seed + static_cast<uint32_t>(octave));
+                switch (type) {
+                    case NoiseType::Value: Accumulate(points, out, count, frequency, amplitude, [&layer](P const& p) { return layer.Value(p); }); break;
+                    case NoiseType::Perlin: Accumulate(points, out, count, frequency, amplitude, [&layer](P const& p) { return layer.Perlin(p); }); break;
+                    default: Accumulate(points, out, count, frequency, amplitude, [&layer](P const& p) { return layer.Simplex(p); }); break;
+                }
+                total += amplitude;
+                amplitude *= gain;
+                frequency *= lacunarity;
+            }
+
+            if (total <= 0.0f) return;
+            float inverse = 1.0f / total;
+            for (size_t i = 0; i < count; i++) out[i] *= inverse;
+        }
+
+    private:
+        constexpr static int32_t FastFloor(float value) {
+            auto truncated = static_cast<int32_t>(value);
+            return truncated - static_cast<int32_t>(value < static_cast<float>(truncated));
+        }
+
+        // 6t^5 - 15t^4 + 10t^3
+        constexpr static float Fade(float t) {
+            return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+        }
+
+        constexpr static float Mix(float a, float b, float t) {
+            return a + (b - a) * t;
+        }
+
+        constexpr uint32_t Hash(int32_t x, int32_t y, int32_t z) const {
+            uint32_t hash = seed ^ (static_cast<uint32_t>(x) * 501125321u) ^ (static_cast<uint32_t>(y) * 1136930381u) ^ (static_cast<uint32_t>(z) * 1720413743u);
+            hash *= 0x27d4eb2du;
+            hash ^= hash >> 15;
+            hash *= 0x2c1b3c6du;
+            hash ^= hash >> 12;
+            return hash;
+        }
+
+        constexpr static float LatticeValue(uint32_t hash) {
+            return static_cast<float>(hash & 0xffffu) * (2.0f / 65535.0f) - 1.0f;
+        }
+
+        // branches on random hash bits mispredict half the time, so signs and selections are done with arithmetic
+        constexpr static float Sign(uint32_t bit) {
+            return 1.0f - 2.0f * static_cast<float>(bit & 1u);
+        }
+
+        constexpr static float Select(bool condition, float a, float b) {
+            float mask = static_cast<float>(condition);
+            return b + (a - b) * mask;
+        }
+
+        constexpr static float Gradient(uint32_t hash, float x) {
+            return Sign(hash) * x;
+        }
+
+        // 8 directions, (+-1, +-2) and (+-2, +-1)
+        constexpr static float Gradient(uint32_t hash, float x, float y) {
+            uint32_t h = hash & 7u;
+            float u = Select(h < 4, x, y);
+            float v = Select(h < 4, y, x);
+            return Sign(h) * u + Sign(h >> 1) * 2.0f * v;
+        }
+
+        // the 12 cube edge directions from improved noise, padded to 16
+        constexpr static float Gradient(uint32_t hash, float x, float y, float z) {
+            uint32_t h = hash & 15u;
+            float u = Select(h < 8, x, y);
+            float v = Select(h < 4, y, Select((h | 2u) == 14u, x, z));
+            return Sign(h) * u + Sign(h >> 1) * v;
+        }
+
+        constexpr static float SimplexGradient(uint32_t hash, float x) {
+            float gradient = 1.0f + static_cast<float>(hash & 7u);
+            return Sign(hash >> 3) * gradient * x;
+        }
+
+        // (max(0, t))^4 * gradient
+        constexpr static float SimplexCorner(float t, float gradient) {
+            t = std::max(t, 0.0f);
+            t *= t;
+            return t * t * gradient;
+        }
+
+        template<typename P, typename F>
+        static void Fill(std::span<P const> points, std::span<float> out, F&& fn) {
+            size_t count = std::min(points.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i] = fn(points[i]);
+            }
+        }
+
+        template<typename P, typename F>
+        static void Accumulate(std::span<P const> points, std::span<float> out, size_t count, float frequency, float amplitude, F&& fn) {
+            for (size_t i = 0; i < count; i++) {
+                out[i] += fn(points[i] * frequency) * amplitude;
+            }
+        }
+    };
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Vector3Utils.hpp"
+#include "ColorUtils.hpp"
+
+#include <memory>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace Sombrero {
+
+    // CPU particles stored as structure of arrays.
+    // Every component lives in its own cache line aligned float array so the integrators
+    // below are plain loops over contiguous floats, which the compiler turns into SIMD at -O3.
+    // Dead particles are removed by swapping the last one into their slot, order is not kept.
+    class ParticleBuffer {
+    public:
+        // floats per cache line, channels are padded to a multiple of this
+        constexpr static size_t Alignment = 64 / sizeof(float);
+
+        enum Channel : size_t {
+            PositionX, PositionY, PositionZ,
+            VelocityX, VelocityY, VelocityZ,
+            ColorR, ColorG, ColorB, ColorA,
+            // normalized age, 0 when emitted and 1 when dead
+            Life,
+            InverseLifetime,
+            ChannelCount
+        };
+
+        explicit ParticleBuffer(size_t capacity) :
+            maxCount(capacity),
+            stride((capacity + Alignment - 1) / Alignment * Alignment),
+            storage(new float[stride * ChannelCount + Alignment]())
+        {
+            // new[] only guarantees alignof(float), round the base up to the cache line
+            auto address = reinterpret_cast<uintptr_t>(storage.get());
+            auto aligned = (address + 63) & ~static_cast<uintptr_t>(63);
+            base = reinterpret_cast<float*>(aligned);
+        }
+
+        // base points into storage, so the moved from buffer is left empty rather than sharing it
+        ParticleBuffer(ParticleBuffer&& other) noexcept :
+            maxCount(std::exchange(other.maxCount, 0)),
+            count(std::exchange(other.count, 0)),
+            stride(std::exchange(other.stride, 0)),
+            storage(std::move(other.storage)),
+            base(std::exchange(other.base, nullptr)) {}
+
+        ParticleBuffer& operator=(ParticleBuffer&& other) noexcept {
+            if (this != &other) {
+                maxCount = std::exchange(other.maxCount, 0);
+                count = std::exchange(other.count, 0);
+                stride = std::exchange(other.stride, 0);
+                storage = std::move(other.storage);
+                base = std::exchange(other.base, nullptr);
+            }
+            return *this;
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        size_t capacity() const {
+            return maxCount;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        void Clear() {
+            count = 0;
+        }
+
+        /// Adds a particle. Returns false if the buffer is full
+        bool Emit(FastVector3 const& position, FastVector3 const& velocity, FastColor const& color, float lifetime) {
+            if (count == maxCount) return false;
+
+            size_t i = count++;
+            Data(PositionX)[i] = position.x;
+            Data(PositionY)[i] = position.y;
+            Data(PositionZ)[i] = position.z;
+            Data(VelocityX)[i] = velocity.x;
+            Data(VelocityY)[i] = velocity.y;
+            Data(VelocityZ)[i] = velocity.z;
+            Data(ColorR)[i] = color.r;
+            Data(ColorG)[i] = color.g;
+            Data(ColorB)[i] = color.b;
+            Data(ColorA)[i] = color.a;
+            // a particle without a lifetime is born dead and goes on the next RemoveDead
+            Data(Life)[i] = lifetime > 0.0f ? 0.0f : 1.0f;
+            Data(InverseLifetime)[i] = lifetime > 0.0f ? 1.0f / lifetime : 0.0f;
+            return true;
+        }
+
+        /// velocity += gravity * deltaTime
+        void ApplyGravity(FastVector3 const& gravity, float deltaTime) {
+            AddScalar(Data(VelocityX), gravity.x * deltaTime);
+            AddScalar(Data(VelocityY), gravity.y * deltaTime);
+            AddScalar(Data(VelocityZ), gravity.z * deltaTime);
+        }
+
+        /// Linear drag, velocity *= 1 - drag * deltaTime (clamped so it never reverses)
+        void ApplyDrag(float drag, float deltaTime) {
+            float factor = std::max(0.0f, 1.0f - drag * deltaTime);
+            Scale(Data(VelocityX), factor);
+            Scale(Data(VelocityY), factor);
+            Scale(Data(VelocityZ), factor);
+        }
+
+        /// position += velocity * deltaTime and ages every particle
+        void Integrate(float deltaTime) {
+            MultiplyAdd(Data(PositionX), Data(VelocityX), deltaTime);
+            MultiplyAdd(Data(PositionY), Data(VelocityY), deltaTime);
+            MultiplyAdd(Data(PositionZ), Data(VelocityZ), deltaTime);
+            MultiplyAdd(Data(Life), Data(InverseLifetime), deltaTime);
+        }
+
+        /// color = FastColor::LerpUnclamped(start, end, normalized age), one channel at a time
+        void ApplyColorOverLife(FastColor const& start, FastColor const& end) {
+            float const* __restrict life = Data(Life);
+            LerpChannel(Data(ColorR), life, start.r, end.r);
+            LerpChannel(Data(ColorG), life, start.g, end.g);
+            LerpChannel(Data(ColorB), life, start.b, end.b);
+            LerpChannel(Data(ColorA), life, start.a, end.a);
+        }
+
+        /// Swap removes every particle that reached the end of its lifetime
+        /// @return how many were removed
+        size_t RemoveDead() {
+            float const* life = Data(Life);
+            size_t removed = 0;
+            size_t i = 0;
+            while (i < count) {
+                if (life[i] >= 1.0f) {
+                    count--;
+                    removed++;
+                    if (i != count) {
+                        for (size_t channel = 0; channel < ChannelCount; channel++) {
+                            float* data = Data(static_cast<Channel>(channel));
+                            data[i] = data[count];
+                        }
+                    }
+                    // don't advance, the swapped in particle still needs checking
+                    continue;
+                }
+                i++;
+            }
+            return removed;
+        }
+
+        // Typical per frame update, each step is a separate pass over its channels
+        void Update(float deltaTime, FastVector3 const& gravity, float drag, FastColor const& startColor, FastColor const& endColor) {
+            ApplyGravity(gravity, deltaTime);
+            ApplyDrag(drag, deltaTime);
+            Integrate(deltaTime);
+            RemoveDead();
+            ApplyColorOverLife(startColor, endColor);
+        }
+
+        /// Raw access to one component of every live particle, for uploading to meshes or custom integrators
+        std::span<float> GetChannel(Channel channel) {
+            return {Data(channel), count};
+        }
+
+        std::span<float const> GetChannel(Channel channel) const {
+            return {Data(channel), count};
+        }
+
+        FastVector3 GetPosition(size_t i) const {
+            return {Data(PositionX)[i], Data(PositionY)[i], Data(PositionZ)[i]};
+        }
+
+        FastVector3 GetVelocity(size_t i) const {
+            return {Data(VelocityX)[i], Data(VelocityY)[i], Data(VelocityZ)[i]};
+        }
+
+        FastColor GetColor(size_t i) const {
+            return {Data(ColorR)[i], Data(ColorG)[i], Data(ColorB)[i], Data(ColorA)[i]};
+        }
+
+        float GetNormalizedAge(size_t i) const {
+            return Data(Life)[i];
+        }
+
+    private:
+        size_t maxCount;
+        size_t count = 0;
+        // floats between the start of two channels
+        size_t stride;
+        std::unique_ptr<float[]> storage;
+        float* base;
+
+        float* Data(Channel channel) {
+            return base + stride * channel;
+        }
+
+        float const* Data(Channel channel) const {
+            return base + stride * channel;
+        }
+
+        void AddScalar(float* __restrict data, float value) {
+            for (size_t i = 0; i < count; i++) {
+                data[i] += value;
+            }
+        }
+
+        void Scale(float* __restrict data, float value) {
+            for (size_t i = 0; i < count; i++) {
+                data[i] *= value;
+            }
+        }
+
+        void MultiplyAdd(float* __restrict data, float const* __restrict add, float factor) {
+            for (size_t i = 0; i < count; i++) {
+                data[i] += add[i] * factor;
+            }
+        }
+
+        void LerpChannel(float* __restrict data, float const* __restrict t, float from, float to) {
+            float difference = to - from;
+            for (size_t i = 0; i < count; i++) {
+                data[i] = from + difference * t[i];
+            }
+        }
+    };
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "Vector3Utils.hpp"
+#include "QuaternionUtils.hpp"
+
+#include <bit>
+#include <span>
+#include <cstdint>
+#include <algorithm>
+
+// Compact storage for long histories of vectors and rotations (replays, trails, recorded motion).
+// Every type converts one value at a time with a constructor/Unpack and has span based
+// Pack/Unpack for bulk conversion, written as flat loops so they vectorize.
+namespace Sombrero {
+
+    // IEEE 754 binary16 conversion, round to nearest even. Uses the hardware conversion where the target has it
+    constexpr uint16_t FloatToHalf(float value) {
+#if defined(__ARM_FP16_FORMAT_IEEE)
+        if (!std::is_constant_evaluated()) {
+            return std::bit_cast<uint16_t>(static_cast<__fp16>(value));
+        }
+#endif
+        uint32_t x = std::bit_cast<uint32_t>(value);
+        uint32_t sign = x & 0x80000000u;
+        x ^= sign;
+
+        uint32_t half;
+        if (x >= 0x47800000u) {
+            // too large, infinity or NaN
+            half = x > 0x7f800000u ? 0x7e00u : 0x7c00u;
+        } else if (x < 0x38800000u) {
+            // subnormal or zero, let the float adder do the rounding by adding 0.5
+            half = std::bit_cast<uint32_t>(std::bit_cast<float>(x) + 0.5f) - 0x3f000000u;
+        } else {
+            uint32_t odd = (x >> 13) & 1u;
+            // rebias the exponent and round
+            x += (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu + odd;
+            half = x >> 13;
+        }
+        return static_cast<uint16_t>((sign >> 16) | half);
+    }
+
+    constexpr float HalfToFloat(uint16_t half) {
+#if defined(__ARM_FP16_FORMAT_IEEE)
+        if (!std::is_constant_evaluated()) {
+            return static_cast<float>(std::bit_cast<__fp16>(half));
+        }
+#endif
+        constexpr uint32_t shiftedExponent = 0x7c00u << 13;
+        uint32_t bits = (half & 0x7fffu) << 13;
+        uint32_t exponent = bits & shiftedExponent;
+        bits += static_cast<uint32_t>(127 - 15) << 23;
+
+        if (exponent == shiftedExponent) {
+            // infinity or NaN
+            bits += static_cast<uint32_t>(128 - 16) << 23;
+        } else if (exponent == 0) {
+            // subnormal, renormalize through a float subtraction
+            bits += 1u << 23;
+            bits = std::bit_cast<uint32_t>(std::bit_cast<float>(bits) - std::bit_cast<float>(113u << 23));
+        }
+        return std::bit_cast<float>(bits | (static_cast<uint32_t>(half & 0x8000u) << 16));
+    }
+
+    // Half precision FastVector3, 6 bytes instead of 12.
+    // Relative error is at most 2^-11 (~0.05%) per axis, so 0.5mm at 1m and ~5mm at 10m.
+    // Magnitudes above 65504 become infinity.
+    struct FastVector3h {
+        uint16_t x = 0, y = 0, z = 0;
+
+        constexpr FastVector3h() = default;
+        constexpr FastVector3h(FastVector3 const& vector) : x(FloatToHalf(vector.x)), y(FloatToHalf(vector.y)), z(FloatToHalf(vector.z)) {}
+
+        constexpr FastVector3 Unpack() const {
+            return {HalfToFloat(x), HalfToFloat(y), HalfToFloat(z)};
+        }
+
+        static void Pack(std::span<FastVector3 const> in, std::span<FastVector3h> out) {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i].x = FloatToHalf(in[i].x);
+                out[i].y = FloatToHalf(in[i].y);
+                out[i].z = FloatToHalf(in[i].z);
+            }
+        }
+
+        static void Unpack(std::span<FastVector3h const> in, std::span<FastVector3> out) {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i].x = HalfToFloat(in[i].x);
+                out[i].y = HalfToFloat(in[i].y);
+                out[i].z = HalfToFloat(in[i].z);
+            }
+        }
+
+        constexpr bool operator==(FastVector3h const&) const = default;
+    };
+    static_assert(sizeof(FastVector3h) == 6);
+
+    // 16 bit fixed point position inside a known box, 6 bytes.
+    // Unlike half floats the error is uniform across the box: at most extent / 65535 / 2 per axis,
+    // ~0.08mm per axis for a 10m box. Positions outside the box are clamped to it.
+    struct FixedVector3 {
+        uint16_t x = 0, y = 0, z = 0;
+
+        constexpr bool operator==(FixedVector3 const&) const = default;
+    };
+    static_assert(sizeof(FixedVector3) == 6);
+
+    // Converts between FastVector3 and FixedVector3 for one box
+    struct Vector3Quantizer {
+        FastVector3 min;
+        FastVector3 scale;
+        FastVector3 inverseScale;
+
+        constexpr static float Steps = 65535.0f;
+
+        constexpr Vector3Quantizer(FastVector3 const& min, FastVector3 const& max) :
+            min(min),
+            scale(Extent(max.x - min.x) / Steps, Extent(max.y - min.y) / Steps, Extent(max.z - min.z) / Steps),
+            inverseScale(Steps / Extent(max.x - min.x), Steps / Extent(max.y - min.y), Steps / Extent(max.z - min.z)) {}
+
+        // largest error on any axis for positions inside the box
+        constexpr FastVector3 MaxError() const {
+            return scale * 0.5f;
+        }
+
+        constexpr FixedVector3 Pack(FastVector3 const& vector) const {
+            return {Quantize(vector.x, min.x, inverseScale.x), Quantize(vector.y, min.y, inverseScale.y), Quantize(vector.z, min.z, inverseScale.z)};
+        }
+
+        constexpr FastVector3 Unpack(FixedVector3 const& fixed) const {
+            return {min.x + fixed.x * scale.x, min.y + fixed.y * scale.y, min.z + fixed.z * scale.z};
+        }
+
+        void Pack(std::span<FastVector3 const> in, std::span<FixedVector3> out) const {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i].x = Quantize(in[i].x, min.x, inverseScale.x);
+                out[i].y = Quantize(in[i].y, min.y, inverseScale.y);
+                out[i].z = Quantize(in[i].z, min.z, inverseScale.z);
+            }
+        }
+
+        void Unpack(std::span<FixedVector3 const> in, std::span<FastVector3> out) const {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i].x = min.x + static_cast<float>(in[i].x) * scale.x;
+                out[i].y = min.y + static_cast<float>(in[i].y) * scale.y;
+                out[i].z = min.z + static_cast<float>(in[i].z) * scale.z;
+            }
+        }
+
+    private:
+        // avoid dividing by zero for flat boxes
+        constexpr static float Extent(float extent) {
+            return extent > 0.0f ? extent : 1.0f;
+        }
+
+        constexpr static uint16_t Quantize(float value, float min, float inverseScale) {
+            float steps = std::clamp((value - min) * inverseScale, 0.0f, Steps);
+            return static_cast<uint16_t>(steps + 0.5f);
+        }
+    };
+
+    namespace detail {
+        // The three smallest components of a unit quaternion are within +-1/sqrt(2)
+        constexpr float SmallestThreeRange = 0.70710678f;
+
+        // Index of the largest absolute component, and the other three (sign flipped so the largest is positive)
+        inline uint32_t SmallestThree(FastQuaternion const& rotation, float (&smallest)[3]) {
+            float components[4] = {rotation.x, rotation.y, rotation.z, rotation.w};
+            uint32_t largest = 0;
+            for (uint32_t i = 1; i < 4; i++) {
+                if (std::abs(components[i]) > std::abs(components[largest])) largest = i;
+            }
+            float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+            for (uint32_t i = 0, j = 0; i < 4; i++) {
+                if (i != largest) smallest[j++] = components[i] * sign;
+            }
+            return largest;
+        }
+
+        template<uint32_t Bits>
+        constexpr uint32_t QuantizeSigned(float value) {
+            constexpr float max = static_cast<float>((1u << Bits) - 1);
+            float normalized = std::clamp((value + SmallestThreeRange) * (0.5f / SmallestThreeRange), 0.0f, 1.0f);
+            return static_cast<uint32_t>(normalized * max + 0.5f);
+        }
+
+        template<uint32_t Bits>
+        constexpr float DequantizeSigned(uint32_t value) {
+            constexpr float scale = 2.0f * SmallestThreeRange / static_cast<float>((1u << Bits) - 1);
+            return static_cast<float>(value) * scale - SmallestThreeRange;
+        }
+
+        inline FastQuaternion FromSmallestThree(uint32_t largest, float a, float b, float c) {
+            float d = std::sqrt(std::max(0.0f, 1.0f - a * a - b * b - c * c));
+            switch (largest) {
+                case 0: return {d, a, b, c};
+                case 1: return {a, d, b, c};
+                case 2: return {a, b, d, c};
+                default: return {a, b, c, d};
+            }
+        }
+    }
+
+    // Unit quaternion in 32 bits using smallest three: 2 bits for which component is dropped, 10 bits for each other one.
+    // The stored components are off by at most ~0.0007, the rebuilt largest one by ~0.002. Rotations stay within ~0.25 degrees.
+    // Input is expected to be normalized.
+    struct PackedQuaternion32 {
+        uint32_t data = 0;
+
+        constexpr PackedQuaternion32() = default;
+        PackedQuaternion32(FastQuaternion const& rotation) {
+            float smallest[3];
+            uint32_t largest = detail::SmallestThree(rotation, smallest);
+            data = (largest << 30) |
+                   (detail::QuantizeSigned<10>(smallest[0]) << 20) |
+                   (detail::QuantizeSigned<10>(smallest[1]) << 10) |
+                   detail::QuantizeSigned<10>(smallest[2]);
+        }
+
+        FastQuaternion Unpack() const {
+            return detail::FromSmallestThree(data >> 30,
+                                             detail::DequantizeSigned<10>((data >> 20) & 0x3ffu),
+                                             detail::DequantizeSigned<10>((data >> 10) & 0x3ffu),
+                                             detail::DequantizeSigned<10>(data & 0x3ffu));
+        }
+
+        static void Pack(std::span<FastQuaternion const> in, std::span<PackedQuaternion32> out) {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i] = PackedQuaternion32(in[i]);
+            }
+        }
+
+        static void Unpack(std::span<PackedQuaternion32 const> in, std::span<FastQuaternion> out) {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i] = in[i].Unpack();
+            }
+        }
+
+        constexpr bool operator==(PackedQuaternion32 const&) const = default;
+    };
+    static_assert(sizeof(PackedQuaternion32) == 4);
+
+    // Unit quaternion in 48 bits using smallest three: 2 bits for the dropped component, 15 bits for each other one.
+    // The stored components are off by at most ~0.00002, the rebuilt largest one by ~0.00006. Rotations stay within ~0.01 degrees.
+    // Input is expected to be normalized.
+    struct PackedQuaternion48 {
+        uint16_t data[3] = {0, 0, 0};
+
+        constexpr PackedQuaternion48() = default;
+        PackedQuaternion48(FastQuaternion const& rotation) {
+            float smallest[3];
+            uint64_t largest = detail::SmallestThree(rotation, smallest);
+            uint64_t bits = (largest << 45) |
+                            (static_cast<uint64_t>(detail::QuantizeSigned<15>(smallest[0])) << 30) |
+                            (static_cast<uint64_t>(detail::QuantizeSigned<15>(smallest[1])) << 15) |
+                            static_cast<uint64_t>(detail::QuantizeSigned<15>(smallest[2]));
+            data[0] = static_cast<uint16_t>(bits >> 32);
+            data[1] = static_cast<uint16_t>(bits >> 16);
+            data[2] = static_cast<uint16_t>(bits);
+        }
+
+        FastQuaternion Unpack() const {
+            uint64_t bits = (static_cast<uint64_t>(data[0]) << 32) | (static_cast<uint64_t>(data[1]) << 16) | data[2];
+            return detail::FromSmallestThree(static_cast<uint32_t>(bits >> 45),
+                                             detail::DequantizeSigned<15>(static_cast<uint32_t>(bits >> 30) & 0x7fffu),
+                                             detail::DequantizeSigned<15>(static_cast<uint32_t>(bits >> 15) & 0x7fffu),
+                                             detail::DequantizeSigned<15>(static_cast<uint32_t>(bits) & 0x7fffu));
+        }
+
+        static void Pack(std::span<FastQuaternion const> in, std::span<PackedQuaternion48> out) {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i] = PackedQuaternion48(in[i]);
+            }
+        }
+
+        static void Unpack(std::span<PackedQuaternion48 const> in, std::span<FastQuaternion> out) {
+            size_t count = std::min(in.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i] = in[i].Unpack();
+            }
+        }
+
+        constexpr bool operator==(PackedQuaternion48 const&) const = default;
+    };
+    static_assert(sizeof(PackedQuaternion48) == 6);
+}
@@ -139,6 +139,45 @@ namespace Sombrero {
         //   return FastQuaternion::Normalize(q);
         // }
 
+        // Port of Unity's Quaternion.LookRotation, rows are right, up and forward
+        static FastQuaternion LookRotation(FastVector3 const& forward, FastVector3 const& upwards = FastVector3::up())
+        {
+            FastVector3 vector = FastVector3::Normalize(forward);
+            if (vector.sqrMagnitude() == 0.0f) return FastQuaternion::identity();
+
+            FastVector3 vector2 = FastVector3::Normalize(FastVector3::Cross(upwards, vector));
+            // forward and up are parallel, pick any perpendicular axis instead
+            if (vector2.sqrMagnitude() == 0.0f) {
+                vector2 = FastVector3::Normalize(FastVector3::Cross(std::abs(vector.x) < 0.9f ? FastVector3::right() : FastVector3::forward(), vector));
+            }
+            FastVector3 vector3 = FastVector3::Cross(vector, vector2);
+
+            float m00 = vector2.x, m01 = vector2.y, m02 = vector2.z;
+            float m10 = vector3.x, m11 = vector3.y, m12 = vector3.z;
+            float m20 = vector.x, m21 = vector.y, m22 = vector.z;
+
+            float trace = m00 + m11 + m22;
+            if (trace > 0.0f) {
+                float num = std::sqrt(trace + 1.0f);
+                float w = num * 0.5f;
+                num = 0.5f / num;
+                return FastQuaternion((m12 - m21) * num, (m20 - m02) * num, (m01 - m10) * num, w);
+            }
+            if (m00 >= m11 && m00 >= m22) {
+                float num = std::sqrt(1.0f + m00 - m11 - m22);
+                float num2 = 0.5f / num;
+                return FastQuaternion(0.5f * num, (m01 + m10) * num2, (m02 + m20) * num2, (m12 - m21) * num2);
+            }
+            if (m11 > m22) {
+                float num = std::sqrt(1.0f + m11 - m00 - m22);
+                float num2 = 0.5f / num;
+                return FastQuaternion((m10 + m01) * num2, 0.5f * num, (m21 + m12) * num2, (m20 - m02) * num2);
+            }
+            float num = std::sqrt(1.0f + m22 - m00 - m11);
+            float num2 = 0.5f / num;
+            return FastQuaternion((m20 + m02) * num2, (m21 + m12) * num2, 0.5f * num, (m01 - m10) * num2);
+        }
+
         constexpr auto get_normalized() const
         {
             return FastQuaternion::Normalize(*this);
@@ -179,8 +218,7 @@ namespace std {
     {
         size_t operator()(const Sombrero::FastQuaternion & quat) const
         {
-            std::hash<float> h;
-            return h(quat.x) ^ h(quat.y) ^ h(quat.z) ^ h(quat.w);
+            return Sombrero::HashFloats(quat.x, quat.y, quat.z, quat.w);
         }
     };
 }
\ No newline at end of file
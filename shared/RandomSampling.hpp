@@ -0,0 +1,270 @@
+#pragma once
+
+#include "RandomUtils.hpp"
+#include "Vector2Utils.hpp"
+#include "Vector3Utils.hpp"
+#include "QuaternionUtils.hpp"
+#include "ColorUtils.hpp"
+
+#include <span>
+#include <cmath>
+#include <concepts>
+#include <utility>
+#include <bit>
+#include <cstdint>
+#include <algorithm>
+
+namespace Sombrero {
+
+    // Anything that hands out floats in [0, 1), such as RandomStream or Xoshiro128Plus
+    template<typename T>
+    concept UniformRandom = requires(T& random) {
+        { random.NextFloat() } -> std::same_as<float>;
+    };
+
+    namespace detail {
+        constexpr float TwoPi = 6.28318530717958647692f;
+
+        // Sign bit tricks rather than comparisons, compilers like to turn comparisons back into branches
+        constexpr float Abs(float x) {
+            return std::bit_cast<float>(std::bit_cast<uint32_t>(x) & 0x7fffffffu);
+        }
+
+        // max(x, 0) by clearing negative values with their own sign bit
+        constexpr float ClampPositive(float x) {
+            auto bits = std::bit_cast<int32_t>(x);
+            return std::bit_cast<float>(bits & ~(bits >> 31));
+        }
+
+        constexpr float Saturate(float x) {
+            return 1.0f - ClampPositive(1.0f - ClampPositive(x));
+        }
+
+        // sin(2 * pi * y) for y in [-0.25, 0.25], Taylor series to x^11. Error is below float precision
+        constexpr float SinQuarterTurn(float y) {
+            float x = y * TwoPi;
+            float x2 = x * x;
+            return x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f + x2 * (-1.0f / 39916800.0f))))));
+        }
+
+        // sin(2 * pi * turns) for turns in [0, 1.5). A polynomial instead of libm so batch loops vectorize,
+        // and the folding is done with bits since the inputs are random and branches would mispredict
+        constexpr float SinTurns(float turns) {
+            // turns is never negative so truncating rounds down
+            float x = turns - static_cast<float>(static_cast<int32_t>(turns + 0.5f));
+            uint32_t sign = std::bit_cast<uint32_t>(x) & 0x80000000u;
+            float ax = Abs(x);
+            return std::bit_cast<float>(std::bit_cast<uint32_t>(SinQuarterTurn(std::min(ax, 0.5f - ax))) ^ sign);
+        }
+
+        // cos(2 * pi * turns) for turns in [0, 1)
+        constexpr float CosTurns(float turns) {
+            return SinTurns(turns + 0.25f);
+        }
+
+        // The samplers below turn independent uniforms in [0, 1) into the wanted distribution without rejection,
+        // so every sample costs the same and batches have no data dependent branches
+
+        // z is uniform on [-1, 1] for a uniform point on the sphere (Archimedes), the angle around z is uniform too
+        constexpr FastVector3 OnUnitSphere(float u, float v) {
+            float z = 1.0f - 2.0f * u;
+            float r = std::sqrt(ClampPositive(1.0f - z * z));
+            return { r * CosTurns(v), r * SinTurns(v), z };
+        }
+
+        // Radius has a CDF of r^3, and so does the max of three uniforms. Cheaper than a cube root
+        constexpr FastVector3 InsideUnitSphere(float u, float v, float r0, float r1, float r2) {
+            // non negative floats order the same as their bits
+            auto radiusBits = std::max(std::bit_cast<int32_t>(r0), std::max(std::bit_cast<int32_t>(r1), std::bit_cast<int32_t>(r2)));
+            float radius = std::bit_cast<float>(radiusBits);
+            FastVector3 direction = OnUnitSphere(u, v);
+            return { direction.x * radius, direction.y * radius, direction.z * radius };
+        }
+
+        // Radius has a CDF of r^2
+        constexpr FastVector2 InsideUnitCircle(float u, float v) {
+            float radius = std::sqrt(u);
+            return { radius * CosTurns(v), radius * SinTurns(v) };
+        }
+
+        // Shoemake, "Uniform random rotations", Graphics Gems III
+        constexpr FastQuaternion RotationUniform(float u, float v, float w) {
+            float a = std::sqrt(1.0f - u);
+            float b = std::sqrt(u);
+            return { a * SinTurns(v), a * CosTurns(v), b * SinTurns(w), b * CosTurns(w) };
+        }
+
+        // Same result as ColorHSVToRGB for hue in [0, 1], without the switch on the hue sector
+        constexpr float HSVChannel(float h, float s, float v, float offset) {
+            float k = h + offset;
+            k -= static_cast<float>(static_cast<int32_t>(k));
+            float c = Saturate(Abs(k * 6.0f - 3.0f) - 1.0f);
+            return v * (1.0f - s + s * c);
+        }
+
+        constexpr FastColor ColorHSV(float h, float s, float v, float a) {
+            return { HSVChannel(h, s, v, 1.0f), HSVChannel(h, s, v, 2.0f / 3.0f), HSVChannel(h, s, v, 1.0f / 3.0f), a };
+        }
+
+        template<UniformRandom R>
+        constexpr void FillUniform(R& random, std::span<float> out) {
+            if constexpr (requires { random.Fill(out); }) {
+                random.Fill(out);
+            } else {
+                for (auto& value : out) value = random.NextFloat();
+            }
+        }
+
+        // Generates uniforms a block at a time, then transforms the whole block in one loop.
+        // Pass sample as a lambda, a plain function pointer won't get inlined into the loop
+        template<size_t Uniforms, typename T, typename FillFn, typename SampleFn>
+        void SampleBlocks(std::span<T> out, FillFn&& fill, SampleFn&& sample) {
+            constexpr size_t Block = 64;
+            float uniforms[Uniforms][Block];
+            for (size_t start = 0; start < out.size(); start += Block) {
+                size_t count = std::min(Block, out.size() - start);
+                for (size_t i = 0; i < Uniforms; i++) fill(std::span<float>(uniforms[i], count));
+                [&]<size_t... U>(std::index_sequence<U...>) {
+                    for (size_t i = 0; i < count; i++) out[start + i] = sample(uniforms[U][i]...);
+                }(std::make_index_sequence<Uniforms>());
+            }
+        }
+    }
+
+    // Random points, directions, rotations and colors, matching UnityEngine.Random.
+    // Every function has a thread local version (same generators as RandomFast), a version that takes
+    // a RandomStream or other UniformRandom for reproducible results, and span overloads that fill in batches.
+    // Batches draw their uniforms block by block, so a seeded batch is reproducible but not equal to the same number of single calls.
+    class RandomGeometry {
+        public:
+        // Point inside or on a sphere with radius 1
+
+        static FastVector3 insideUnitSphere() {
+            return insideUnitSphere(RandomFast::Engine());
+        }
+
+        template<UniformRandom R>
+        static constexpr FastVector3 insideUnitSphere(R& random) {
+            float u = random.NextFloat();
+            float v = random.NextFloat();
+            float r0 = random.NextFloat();
+            float r1 = random.NextFloat();
+            float r2 = random.NextFloat();
+            return detail::InsideUnitSphere(u, v, r0, r1, r2);
+        }
+
+        static void insideUnitSphere(std::span<FastVector3> out) {
+            detail::SampleBlocks<5>(out, FillThreadLocal, [](float u, float v, float r0, float r1, float r2) { return detail::InsideUnitSphere(u, v, r0, r1, r2); });
+        }
+
+        template<UniformRandom R>
+        static void insideUnitSphere(R& random, std::span<FastVector3> out) {
+            detail::SampleBlocks<5>(out, [&random](std::span<float> uniforms) { detail::FillUniform(random, uniforms); }, [](float u, float v, float r0, float r1, float r2) { return detail::InsideUnitSphere(u, v, r0, r1, r2); });
+        }
+
+        // Point on the surface of a sphere with radius 1
+
+        static FastVector3 onUnitSphere() {
+            return onUnitSphere(RandomFast::Engine());
+        }
+
+        template<UniformRandom R>
+        static constexpr FastVector3 onUnitSphere(R& random) {
+            float u = random.NextFloat();
+            return detail::OnUnitSphere(u, random.NextFloat());
+        }
+
+        static void onUnitSphere(std::span<FastVector3> out) {
+            detail::SampleBlocks<2>(out, FillThreadLocal, [](float u, float v) { return detail::OnUnitSphere(u, v); });
+        }
+
+        template<UniformRandom R>
+        static void onUnitSphere(R& random, std::span<FastVector3> out) {
+            detail::SampleBlocks<2>(out, [&random](std::span<float> uniforms) { detail::FillUniform(random, uniforms); }, [](float u, float v) { return detail::OnUnitSphere(u, v); });
+        }
+
+        // Point inside or on a circle with radius 1
+
+        static FastVector2 insideUnitCircle() {
+            return insideUnitCircle(RandomFast::Engine());
+        }
+
+        template<UniformRandom R>
+        static constexpr FastVector2 insideUnitCircle(R& random) {
+            float u = random.NextFloat();
+            return detail::InsideUnitCircle(u, random.NextFloat());
+        }
+
+        static void insideUnitCircle(std::span<FastVector2> out) {
+            detail::SampleBlocks<2>(out, FillThreadLocal, [](float u, float v) { return detail::InsideUnitCircle(u, v); });
+        }
+
+        template<UniformRandom R>
+        static void insideUnitCircle(R& random, std::span<FastVector2> out) {
+            detail::SampleBlocks<2>(out, [&random](std::span<float> uniforms) { detail::FillUniform(random, uniforms); }, [](float u, float v) { return detail::InsideUnitCircle(u, v); });
+        }
+
+        // Uniformly distributed rotation
+
+        static FastQuaternion rotationUniform() {
+            return rotationUniform(RandomFast::Engine());
+        }
+
+        template<UniformRandom R>
+        static constexpr FastQuaternion rotationUniform(R& random) {
+            float u = random.NextFloat();
+            float v = random.NextFloat();
+            return detail::RotationUniform(u, v, random.NextFloat());
+        }
+
+        static void rotationUniform(std::span<FastQuaternion> out) {
+            detail::SampleBlocks<3>(out, FillThreadLocal, [](float u, float v, float w) { return detail::RotationUniform(u, v, w); });
+        }
+
+        template<UniformRandom R>
+        static void rotationUniform(R& random, std::span<FastQuaternion> out) {
+            detail::SampleBlocks<3>(out, [&random](std::span<float> uniforms) { detail::FillUniform(random, uniforms); }, [](float u, float v, float w) { return detail::RotationUniform(u, v, w); });
+        }
+
+        // Color from HSV and alpha ranges, same parameters as Random.ColorHSV
+
+        static FastColor ColorHSV(float hueMin = 0.0f, float hueMax = 1.0f, float saturationMin = 0.0f, float saturationMax = 1.0f, float valueMin = 0.0f, float valueMax = 1.0f, float alphaMin = 1.0f, float alphaMax = 1.0f) {
+            return ColorHSV(RandomFast::Engine(), hueMin, hueMax, saturationMin, saturationMax, valueMin, valueMax, alphaMin, alphaMax);
+        }
+
+        template<UniformRandom R>
+        static constexpr FastColor ColorHSV(R& random, float hueMin = 0.0f, float hueMax = 1.0f, float saturationMin = 0.0f, float saturationMax = 1.0f, float valueMin = 0.0f, float valueMax = 1.0f, float alphaMin = 1.0f, float alphaMax = 1.0f) {
+            float h = hueMin + (hueMax - hueMin) * random.NextFloat();
+            float s = saturationMin + (saturationMax - saturationMin) * random.NextFloat();
+            float v = valueMin + (valueMax - valueMin) * random.NextFloat();
+            float a = alphaMin + (alphaMax - alphaMin) * random.NextFloat();
+            return detail::ColorHSV(h, s, v, a);
+        }
+
+        static void ColorHSV(std::span<FastColor> out, float hueMin = 0.0f, float hueMax = 1.0f, float saturationMin = 0.0f, float saturationMax = 1.0f, float valueMin = 0.0f, float valueMax = 1.0f, float alphaMin = 1.0f, float alphaMax = 1.0f) {
+            FillColors(out, FillThreadLocal, hueMin, hueMax, saturationMin, saturationMax, valueMin, valueMax, alphaMin, alphaMax);
+        }
+
+        template<UniformRandom R>
+        static void ColorHSV(R& random, std::span<FastColor> out, float hueMin = 0.0f, float hueMax = 1.0f, float saturationMin = 0.0f, float saturationMax = 1.0f, float valueMin = 0.0f, float valueMax = 1.0f, float alphaMin = 1.0f, float alphaMax = 1.0f) {
+            FillColors(out, [&random](std::span<float> uniforms) { detail::FillUniform(random, uniforms); }, hueMin, hueMax, saturationMin, saturationMax, valueMin, valueMax, alphaMin, alphaMax);
+        }
+
+        private:
+        static void FillThreadLocal(std::span<float> uniforms) {
+            RandomFast::Fill(uniforms);
+        }
+
+        template<typename FillFn>
+        static void FillColors(std::span<FastColor> out, FillFn&& fill, float hueMin, float hueMax, float saturationMin, float saturationMax, float valueMin, float valueMax, float alphaMin, float alphaMax) {
+            float hueScale = hueMax - hueMin;
+            float saturationScale = saturationMax - saturationMin;
+            float valueScale = valueMax - valueMin;
+            float alphaScale = alphaMax - alphaMin;
+            auto sample = [=](float h, float s, float v, float a) {
+                return detail::ColorHSV(hueMin + hueScale * h, saturationMin + saturationScale * s, valueMin + valueScale * v, alphaMin + alphaScale * a);
+            };
+            detail::SampleBlocks<4>(out, fill, sample);
+        }
+    };
+}
@@ -1,34 +1,305 @@
 #pragma once
 
 #include <random>
+#include <array>
+#include <span>
+#include <thread>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
 
 namespace Sombrero {
-    class RandomFast {
+
+    namespace detail {
+        // Used to expand a single seed into generator state
+        constexpr uint64_t SplitMix64(uint64_t& state) {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        constexpr uint32_t RotateLeft(uint32_t x, int k) {
+            return (x << k) | (x >> (32 - k));
+        }
+
+        // Top 24 bits to a float in [0, 1)
+        constexpr float ToUnitFloat(uint32_t bits) {
+            return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+        }
+
+        // Maps 32 random bits onto [0, range) with a multiply instead of a modulo
+        constexpr uint32_t ToRange(uint32_t bits, uint32_t range) {
+            return static_cast<uint32_t>((static_cast<uint64_t>(bits) * range) >> 32);
+        }
+    }
+
+    // xoshiro128+ by Blackman and Vigna. 16 bytes of state, a handful of integer ops per number.
+    // Good for floats, the lowest bits are weaker so they are never used directly.
+    struct Xoshiro128Plus {
+        uint32_t state[4];
+
+        constexpr explicit Xoshiro128Plus(uint64_t seed = 0) : state() {
+            uint64_t mix = seed;
+            uint64_t a = detail::SplitMix64(mix);
+            uint64_t b = detail::SplitMix64(mix);
+            state[0] = static_cast<uint32_t>(a);
+            state[1] = static_cast<uint32_t>(a >> 32);
+            state[2] = static_cast<uint32_t>(b);
+            state[3] = static_cast<uint32_t>(b >> 32);
+        }
+
+        constexpr uint32_t Next() {
+            uint32_t result = state[0] + state[3];
+            uint32_t t = state[1] << 9;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = detail::RotateLeft(state[3], 11);
+
+            return result;
+        }
+
+        /// [0, 1)
+        constexpr float NextFloat() {
+            return detail::ToUnitFloat(Next());
+        }
+
+        /// Same as 2^64 calls to Next, used to make non overlapping substreams
+        constexpr void Jump() {
+            constexpr uint32_t jump[] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+            JumpBy(jump);
+        }
+
+        /// Same as 2^96 calls to Next
+        constexpr void LongJump() {
+            constexpr uint32_t jump[] = { 0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662 };
+            JumpBy(jump);
+        }
+
+        constexpr bool operator==(Xoshiro128Plus const& other) const {
+            return state[0] == other.state[0] && state[1] == other.state[1] && state[2] == other.state[2] && state[3] == other.state[3];
+        }
+
+        private:
+        constexpr void JumpBy(uint32_t const (&jump)[4]) {
+            uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            for (uint32_t word : jump) {
+                for (int b = 0; b < 32; b++) {
+                    if (word & (1u << b)) {
+                        s0 ^= state[0];
+                        s1 ^= state[1];
+                        s2 ^= state[2];
+                        s3 ^= state[3];
+                    }
+                    Next();
+                }
+            }
+            state[0] = s0;
+            state[1] = s1;
+            state[2] = s2;
+            state[3] = s3;
+        }
+    };
+
+    // Four xoshiro128+ generators stored lane by lane, so stepping all of them is one SIMD operation per line.
+    // Used by the batch Fill functions
+    struct Xoshiro128PlusX4 {
+        constexpr static int Lanes = 4;
+        uint32_t s0[Lanes], s1[Lanes], s2[Lanes], s3[Lanes];
+
+        constexpr explicit Xoshiro128PlusX4(uint64_t seed = 0) : s0(), s1(), s2(), s3() {
+            uint64_t mix = seed;
+            for (int lane = 0; lane < Lanes; lane++) {
+                uint64_t a = detail::SplitMix64(mix);
+                uint64_t b = detail::SplitMix64(mix);
+                s0[lane] = static_cast<uint32_t>(a);
+                s1[lane] = static_cast<uint32_t>(a >> 32);
+                s2[lane] = static_cast<uint32_t>(b);
+                s3[lane] = static_cast<uint32_t>(b >> 32);
+            }
+        }
+
+        constexpr void Next(uint32_t (&out)[Lanes]) {
+            for (int lane = 0; lane < Lanes; lane++) {
+                out[lane] = s0[lane] + s3[lane];
+                uint32_t t = s1[lane] << 9;
+                s2[lane] ^= s0[lane];
+                s3[lane] ^= s1[lane];
+                s1[lane] ^= s2[lane];
+                s0[lane] ^= s3[lane];
+                s2[lane] ^= t;
+                s3[lane] = detail::RotateLeft(s3[lane], 11);
+            }
+        }
+    };
+
+    // Seeded randomness for anything that has to replay the same way, such as tests, replays or parallel jobs.
+    // A stream only depends on its seed and the calls made on it, never on threads or timing.
+    //
+    // Substreams, pick whichever fits:
+    //  - Fork(key) derives a stream from this one's state and a key without advancing it. Give every object or work item its
+    //    own key and the results stay identical no matter how the work is spread over threads.
+    //  - Split() hands out the next child stream and advances this one, for handing streams to workers in a fixed order.
+    //  - Jump() / LongJump() skip 2^64 / 2^96 numbers, for substreams that are guaranteed never to overlap.
+    class RandomStream {
         public:
-        // https://stackoverflow.com/a/686373/9816000
-        // https://www.cplusplus.com/reference/random/uniform_real_distribution/
-        // https://www.delftstack.com/howto/cpp/how-to-generate-random-float-number-in-cpp/
-        static float randomNumber(float min, float max = 1.0f) {
-            static std::random_device randomDevice;
-            static std::default_random_engine eng(randomDevice());
-            if (min > max) {
-                auto temp = min;
-                min = max;
-                max = temp;
+        // Full generator state, enough to save and restore a stream exactly
+        using State = std::array<uint32_t, 4>;
+
+        constexpr explicit RandomStream(uint64_t seed = 0) : engine(seed) {}
+
+        constexpr explicit RandomStream(State const& state) : engine() {
+            SetState(state);
+        }
+
+        constexpr State GetState() const {
+            return { engine.state[0], engine.state[1], engine.state[2], engine.state[3] };
+        }
+
+        /// Restores a state from GetState. An all zero state is invalid for xoshiro and is replaced with the seed 0 state
+        constexpr void SetState(State const& state) {
+            if ((state[0] | state[1] | state[2] | state[3]) == 0) {
+                engine = Xoshiro128Plus(0);
+                return;
             }
+            for (int i = 0; i < 4; i++) engine.state[i] = state[i];
+        }
+
+        constexpr uint32_t NextUInt() {
+            return engine.Next();
+        }
+
+        /// [0, 1)
+        constexpr float NextFloat() {
+            return engine.NextFloat();
+        }
+
+        /// Between min and max, in either order
+        constexpr float Range(float min, float max) {
+            return min + (max - min) * engine.NextFloat();
+        }
+
+        /// Integer in [min, max). Returns min if max <= min
+        constexpr int32_t Range(int32_t min, int32_t max) {
+            if (max <= min) return min;
+            auto range = static_cast<uint32_t>(static_cast<int64_t>(max) - min);
+            return static_cast<int32_t>(static_cast<int64_t>(min) + detail::ToRange(engine.Next(), range));
+        }
+
+        constexpr void Fill(std::span<float> out, float min = 0.0f, float max = 1.0f) {
+            float scale = max - min;
+            for (auto& value : out) value = min + scale * engine.NextFloat();
+        }
 
-            std::uniform_real_distribution<float> distr(min, max);
+        constexpr void Fill(std::span<int32_t> out, int32_t min, int32_t max) {
+            for (auto& value : out) value = Range(min, max);
+        }
+
+        /// Stream derived from this one's current state and key. Does not advance this stream
+        constexpr RandomStream Fork(uint64_t key) const {
+            uint64_t mix = (static_cast<uint64_t>(engine.state[0]) | (static_cast<uint64_t>(engine.state[1]) << 32)) ^ key;
+            mix = detail::SplitMix64(mix) ^ (static_cast<uint64_t>(engine.state[2]) | (static_cast<uint64_t>(engine.state[3]) << 32));
+            return RandomStream(detail::SplitMix64(mix));
+        }
 
-            return distr(eng);
+        /// Next child stream, advances this one
+        constexpr RandomStream Split() {
+            uint64_t high = engine.Next();
+            uint64_t low = engine.Next();
+            return RandomStream((high << 32) | low);
+        }
+
+        constexpr void Jump() {
+            engine.Jump();
+        }
+
+        constexpr void LongJump() {
+            engine.LongJump();
+        }
+
+        constexpr bool operator==(RandomStream const& other) const = default;
+
+        private:
+        Xoshiro128Plus engine;
+    };
+
+    // Unseeded randomness, each thread has its own generators so calls never race
+    class RandomFast {
+        public:
+        /// Between min and max, in either order
+        static float randomNumber(float min, float max = 1.0f) {
+            return min + (max - min) * Engine().NextFloat();
         }
 
         /// Returns between 0.0f and 1.0f
         static float randomNumber() {
-            static std::random_device randomDevice;
-            static std::default_random_engine eng(randomDevice());
-            static std::uniform_real_distribution<float> distr(0.0f, 1.0f);
+            return Engine().NextFloat();
+        }
 
-            return distr(eng);
+        /// Integer in [min, max), like Unity's Random.Range(int, int). Returns min if max <= min
+        static int32_t randomInt(int32_t min, int32_t max) {
+            if (max <= min) return min;
+            auto range = static_cast<uint32_t>(static_cast<int64_t>(max) - min);
+            return static_cast<int32_t>(static_cast<int64_t>(min) + detail::ToRange(Engine().Next(), range));
+        }
+
+        /// Fills out with floats between min and max
+        static void Fill(std::span<float> out, float min = 0.0f, float max = 1.0f) {
+            float scale = max - min;
+            FillLanes(out, [min, scale](uint32_t bits) { return min + scale * detail::ToUnitFloat(bits); });
+        }
+
+        /// Fills out with integers in [min, max)
+        static void Fill(std::span<int32_t> out, int32_t min, int32_t max) {
+            if (max <= min) {
+                std::fill(out.begin(), out.end(), min);
+                return;
+            }
+            auto range = static_cast<uint32_t>(static_cast<int64_t>(max) - min);
+            FillLanes(out, [min, range](uint32_t bits) { return static_cast<int32_t>(static_cast<uint32_t>(min) + detail::ToRange(bits, range)); });
+        }
+
+        // The calling thread's generator
+        static Xoshiro128Plus& Engine() {
+            thread_local Xoshiro128Plus engine(ThreadSeed());
+            return engine;
+        }
+
+        // The calling thread's batch generator
+        static Xoshiro128PlusX4& BatchEngine() {
+            thread_local Xoshiro128PlusX4 engine(ThreadSeed() ^ 0x5bd1e995ull);
+            return engine;
+        }
+
+        private:
+        // random_device is slow, only touched once per thread
+        static uint64_t ThreadSeed() {
+            std::random_device randomDevice;
+            uint64_t seed = (static_cast<uint64_t>(randomDevice()) << 32) | randomDevice();
+            return seed ^ std::hash<std::thread::id>()(std::this_thread::get_id());
+        }
+
+        template<typename T, typename F>
+        static void FillLanes(std::span<T> out, F&& convert) {
+            // work on a local copy so the state stays in registers instead of going through the thread local
+            Xoshiro128PlusX4 engine = BatchEngine();
+            constexpr int Lanes = Xoshiro128PlusX4::Lanes;
+            uint32_t bits[Lanes];
+
+            size_t i = 0;
+            for (; i + Lanes <= out.size(); i += Lanes) {
+                engine.Next(bits);
+                for (int lane = 0; lane < Lanes; lane++) out[i + lane] = convert(bits[lane]);
+            }
+            if (i < out.size()) {
+                engine.Next(bits);
+                for (int lane = 0; i < out.size(); i++, lane++) out[i] = convert(bits[lane]);
+            }
+            BatchEngine() = engine;
         }
     };
-}
\ No newline at end of file
+}
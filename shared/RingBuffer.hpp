@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Sombrero {
+
+    // Fixed capacity single producer, single consumer queue.
+    // One thread may call TryPush, one (other) thread may call TryPop/Drain, no locks involved.
+    // Capacity must be a power of two so wrapping is a mask
+    template<typename T, size_t Capacity>
+    requires (Capacity > 0 && (Capacity & (Capacity - 1)) == 0)
+    class SPSCRingBuffer {
+    public:
+        /// Producer side. Returns false and drops the item if the consumer has fallen a full buffer behind
+        bool TryPush(T const& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == Capacity) return false;
+
+            items[h & (Capacity - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Consumer side. Returns false if there is nothing to read
+        bool TryPop(T& out) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) return false;
+
+            out = items[t & (Capacity - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Consumer side. Calls fn for every item available right now, oldest first, and frees them all at once
+        /// @return how many items were consumed
+        template<typename F>
+        size_t Drain(F&& fn) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t h = head.load(std::memory_order_acquire);
+            for (size_t i = t; i != h; i++) {
+                fn(items[i & (Capacity - 1)]);
+            }
+            tail.store(h, std::memory_order_release);
+            return h - t;
+        }
+
+        // Only exact when called from either side while the other is idle
+        size_t size() const {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        constexpr static size_t capacity() {
+            return Capacity;
+        }
+
+    private:
+        // keep the two indices on separate cache lines so the threads don't fight over them
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        alignas(64) std::array<T, Capacity> items{};
+    };
+}
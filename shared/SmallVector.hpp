@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Sombrero {
+
+    // Vector that keeps its first N elements inside the object, so short lists live on the stack and only longer ones
+    // go to the heap. Once it has spilled it stays on the heap, like a std::vector.
+    template<typename T, size_t N>
+    requires (N > 0)
+    class SmallVector {
+        public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = T const*;
+
+        SmallVector() = default;
+
+        SmallVector(SmallVector const& other) {
+            reserve(other.count);
+            for (auto const& item : other) push_back(item);
+        }
+
+        SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            TakeFrom(other);
+        }
+
+        SmallVector& operator=(SmallVector const& other) {
+            if (this != &other) {
+                clear();
+                reserve(other.count);
+                for (auto const& item : other) push_back(item);
+            }
+            return *this;
+        }
+
+        SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if (this != &other) {
+                clear();
+                Free();
+                TakeFrom(other);
+            }
+            return *this;
+        }
+
+        ~SmallVector() {
+            clear();
+            Free();
+        }
+
+        T* data() { return items; }
+        T const* data() const { return items; }
+        iterator begin() { return items; }
+        iterator end() { return items + count; }
+        const_iterator begin() const { return items; }
+        const_iterator end() const { return items + count; }
+
+        T& operator[](size_t index) { return items[index]; }
+        T const& operator[](size_t index) const { return items[index]; }
+        T& front() { return items[0]; }
+        T const& front() const { return items[0]; }
+        T& back() { return items[count - 1]; }
+        T const& back() const { return items[count - 1]; }
+
+        size_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        size_t capacity() const {
+            return space;
+        }
+
+        /// Whether the elements are still stored inside the object
+        bool IsInline() const {
+            return items == Inline();
+        }
+
+        void reserve(size_t minimum) {
+            if (minimum > space) Grow(minimum, [](T*) {});
+        }
+
+        void push_back(T const& item) {
+            emplace_back(item);
+        }
+
+        void push_back(T&& item) {
+            emplace_back(std::move(item));
+        }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (count == space) {
+                // build the new element first, args may point into the old storage
+                Grow(space * 2, [&](T* fresh) { new (fresh + count) T(std::forward<Args>(args)...); });
+            } else {
+                new (items + count) T(std::forward<Args>(args)...);
+            }
+            return items[count++];
+        }
+
+        void pop_back() {
+            items[--count].~T();
+        }
+
+        /// Destroys the elements, keeping the storage
+        void clear() {
+            std::destroy_n(items, count);
+            count = 0;
+        }
+
+        private:
+        T* items = Inline();
+        size_t count = 0;
+        size_t space = N;
+        alignas(T) std::byte storage[N * sizeof(T)];
+
+        T* Inline() {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+
+        T const* Inline() const {
+            return std::launder(reinterpret_cast<T const*>(storage));
+        }
+
+        // Moves to a heap block of at least minimum, letting construct fill the slot past the current elements first
+        template<typename F>
+        void Grow(size_t minimum, F&& construct) {
+            size_t newSpace = std::max(minimum, space * 2);
+            T* fresh = std::allocator<T>().allocate(newSpace);
+            construct(fresh);
+            std::uninitialized_move_n(items, count, fresh);
+            std::destroy_n(items, count);
+            Free();
+            items = fresh;
+            space = newSpace;
+        }
+
+        void Free() {
+            if (!IsInline()) std::allocator<T>().deallocate(items, space);
+            items = Inline();
+            space = N;
+        }
+
+        // Empties other into this, which holds nothing and is inline
+        void TakeFrom(SmallVector& other) {
+            if (other.IsInline()) {
+                std::uninitialized_move_n(other.items, other.count, items);
+                count = other.count;
+                other.clear();
+            } else {
+                items = other.items;
+                space = other.space;
+                count = other.count;
+                other.items = other.Inline();
+                other.space = N;
+                other.count = 0;
+            }
+        }
+    };
+
+    // Vector with a fixed capacity of N inside the object. It never allocates, TryPush reports when it is full instead
+    template<typename T, size_t N>
+    class InplaceVector {
+        public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = T const*;
+
+        InplaceVector() = default;
+
+        InplaceVector(InplaceVector const& other) {
+            for (auto const& item : other) new (Items() + count++) T(item);
+        }
+
+        InplaceVector(InplaceVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            for (auto& item : other) new (Items() + count++) T(std::move(item));
+            other.clear();
+        }
+
+        InplaceVector& operator=(InplaceVector const& other) {
+            if (this != &other) {
+                clear();
+                for (auto const& item : other) new (Items() + count++) T(item);
+            }
+            return *this;
+        }
+
+        InplaceVector& operator=(InplaceVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if (this != &other) {
+                clear();
+                for (auto& item : other) new (Items() + count++) T(std::move(item));
+                other.clear();
+            }
+            return *this;
+        }
+
+        ~InplaceVector() {
+            clear();
+        }
+
+        T* data() { return Items(); }
+        T const* data() const { return Items(); }
+        iterator begin() { return Items(); }
+        iterator end() { return Items() + count; }
+        const_iterator begin() const { return Items(); }
+        const_iterator end() const { return Items() + count; }
+
+        T& operator[](size_t index) { return Items()[index]; }
+        T const& operator[](size_t index) const { return Items()[index]; }
+        T& back() { return Items()[count - 1]; }
+        T const& back() const { return Items()[count - 1]; }
+
+        size_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        constexpr static size_t capacity() {
+            return N;
+        }
+
+        /// @return false, without adding item, when already holding N elements
+        bool TryPush(T const& item) {
+            if (count == N) return false;
+            new (Items() + count++) T(item);
+            return true;
+        }
+
+        bool TryPush(T&& item) {
+            if (count == N) return false;
+            new (Items() + count++) T(std::move(item));
+            return true;
+        }
+
+        void pop_back() {
+            Items()[--count].~T();
+        }
+
+        void clear() {
+            std::destroy_n(Items(), count);
+            count = 0;
+        }
+
+        private:
+        size_t count = 0;
+        alignas(T) std::byte storage[N == 0 ? 1 : N * sizeof(T)];
+
+        T* Items() {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+
+        T const* Items() const {
+            return std::launder(reinterpret_cast<T const*>(storage));
+        }
+    };
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "Vector3Utils.hpp"
+#include "QuaternionUtils.hpp"
+
+#include <span>
+#include <vector>
+#include <cmath>
+
+namespace Sombrero {
+
+    // A single cubic piece stored in polynomial form p(t) = ((a * t + b) * t + c) * t + d
+    // so evaluation is 3 multiply-adds per axis no matter which basis built it
+    struct CubicSegment {
+        FastVector3 a, b, c, d;
+
+        constexpr FastVector3 Evaluate(float t) const {
+            return ((a * t + b) * t + c) * t + d;
+        }
+
+        // First derivative, not normalized
+        constexpr FastVector3 Derivative(float t) const {
+            return (a * (3.0f * t) + b * 2.0f) * t + c;
+        }
+
+        // Uniform Catmull-Rom through p1 and p2
+        static constexpr CubicSegment CatmullRom(FastVector3 const& p0, FastVector3 const& p1, FastVector3 const& p2, FastVector3 const& p3) {
+            return {
+                (-p0 + p1 * 3.0f - p2 * 3.0f + p3) * 0.5f,
+                (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * 0.5f,
+                (p2 - p0) * 0.5f,
+                p1
+            };
+        }
+
+        // Cubic bezier from p0 to p3 with p1 and p2 as handles
+        static constexpr CubicSegment Bezier(FastVector3 const& p0, FastVector3 const& p1, FastVector3 const& p2, FastVector3 const& p3) {
+            return {
+                -p0 + p1 * 3.0f - p2 * 3.0f + p3,
+                p0 * 3.0f - p1 * 6.0f + p2 * 3.0f,
+                (p1 - p0) * 3.0f,
+                p0
+            };
+        }
+    };
+
+    // Spline reparameterized by arc length.
+    // The lookup table is built once on construction, after that every query by distance
+    // is a table index + lerp + cubic evaluation, no iteration.
+    class ArcLengthSpline {
+    public:
+        ArcLengthSpline() = default;
+
+        /// @param segments the cubic pieces, in order
+        /// @param resolution table samples per segment, higher is more accurate constant speed
+        /// @param loop whether distances past the end wrap around
+        explicit ArcLengthSpline(std::vector<CubicSegment> segments, int resolution = 16, bool loop = false) : segments(std::move(segments)), loop(loop) {
+            BuildTable(resolution < 1 ? 1 : resolution);
+        }
+
+        /// Catmull-Rom through every point. Open splines extrapolate the end tangents.
+        static ArcLengthSpline CatmullRom(std::span<FastVector3 const> points, bool loop = false, int resolution = 16) {
+            std::vector<CubicSegment> segments;
+            int count = static_cast<int>(points.size());
+            if (count < 2) return FromSinglePoint(points);
+
+            auto at = [&](int i) -> FastVector3 {
+                if (loop) return points[((i % count) + count) % count];
+                if (i < 0) return points[0] * 2.0f - points[1];
+                if (i >= count) return points[count - 1] * 2.0f - points[count - 2];
+                return points[i];
+            };
+
+            int segmentCount = loop ? count : count - 1;
+            segments.reserve(segmentCount);
+            for (int i = 0; i < segmentCount; i++) {
+                segments.push_back(CubicSegment::CatmullRom(at(i - 1), at(i), at(i + 1), at(i + 2)));
+            }
+            return ArcLengthSpline(std::move(segments), resolution, loop);
+        }
+
+        /// Chained cubic bezier, points are laid out as anchor, handle, handle, anchor, handle, handle, anchor...
+        /// Trailing points that do not complete a segment are ignored.
+        /// A loop gets one more segment from the last anchor back to the first, its handles mirror the neighbouring ones
+        static ArcLengthSpline Bezier(std::span<FastVector3 const> points, bool loop = false, int resolution = 16) {
+            std::vector<CubicSegment> segments;
+            if (points.size() < 4) return FromSinglePoint(points);
+
+            segments.reserve((points.size() - 1) / 3 + (loop ? 1 : 0));
+            size_t i = 0;
+            for (; i + 3 < points.size(); i += 3) {
+                segments.push_back(CubicSegment::Bezier(points[i], points[i + 1], points[i + 2], points[i + 3]));
+            }
+            if (loop) {
+                // i is the last anchor used
+                FastVector3 const& last = points[i];
+                FastVector3 const& first = points[0];
+                segments.push_back(CubicSegment::Bezier(last, last * 2.0f - points[i - 1], first * 2.0f - points[1], first));
+            }
+            return ArcLengthSpline(std::move(segments), resolution, loop);
+        }
+
+        float get_length() const {
+            return length;
+        }
+
+        size_t get_segmentCount() const {
+            return segments.size();
+        }
+
+        FastVector3 GetPointAtDistance(float distance) const {
+            if (segments.empty()) return {};
+            auto [segment, t] = Locate(distance);
+            return segments[segment].Evaluate(t);
+        }
+
+        FastVector3 GetTangentAtDistance(float distance) const {
+            if (segments.empty()) return FastVector3::forward();
+            auto [segment, t] = Locate(distance);
+            return FastVector3::Normalize(segments[segment].Derivative(t));
+        }
+
+        FastQuaternion GetRotationAtDistance(float distance, FastVector3 const& up = FastVector3::up()) const {
+            if (segments.empty()) return FastQuaternion::identity();
+            auto [segment, t] = Locate(distance);
+            return FastQuaternion::LookRotation(segments[segment].Derivative(t), up);
+        }
+
+        // Same as calling the above three, but only locates once
+        void GetPoseAtDistance(float distance, FastVector3& position, FastQuaternion& rotation, FastVector3 const& up = FastVector3::up()) const {
+            if (segments.empty()) {
+                position = {};
+                rotation = FastQuaternion::identity();
+                return;
+            }
+            auto [segment, t] = Locate(distance);
+            position = segments[segment].Evaluate(t);
+            rotation = FastQuaternion::LookRotation(segments[segment].Derivative(t), up);
+        }
+
+        // Normalized [0, 1] variant of GetPointAtDistance
+        FastVector3 GetPointAtProgress(float progress) const {
+            return GetPointAtDistance(progress * length);
+        }
+
+        /// Evaluates positions for many distances at once, out must be at least as big as distances
+        void GetPointsAtDistances(std::span<float const> distances, std::span<FastVector3> out) const {
+            size_t count = std::min(distances.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i] = GetPointAtDistance(distances[i]);
+            }
+        }
+
+        /// Evaluates normalized tangents for many distances at once, out must be at least as big as distances
+        void GetTangentsAtDistances(std::span<float const> distances, std::span<FastVector3> out) const {
+            size_t count = std::min(distances.size(), out.size());
+            for (size_t i = 0; i < count; i++) {
+                out[i] = GetTangentAtDistance(distances[i]);
+            }
+        }
+
+        /// Fills out with points evenly spaced along the whole spline, first and last included
+        void SampleEvenly(std::span<FastVector3> out) const {
+            if (out.empty()) return;
+            if (out.size() == 1) {
+                out[0] = GetPointAtDistance(0.0f);
+                return;
+            }
+            float step = length / static_cast<float>(out.size() - 1);
+            for (size_t i = 0; i < out.size(); i++) {
+                out[i] = GetPointAtDistance(step * static_cast<float>(i));
+            }
+        }
+
+    private:
+        std::vector<CubicSegment> segments;
+        // uniformly spaced in distance, stores the global parameter (segment index + t) at that distance
+        std::vector<float> distanceToParameter;
+        float length = 0.0f;
+        float inverseStep = 0.0f;
+        bool loop = false;
+
+        static ArcLengthSpline FromSinglePoint(std::span<FastVector3 const> points) {
+            if (points.empty()) return {};
+            // degenerate segment that sits on the point
+            return ArcLengthSpline({CubicSegment{{}, {}, {}, points[0]}}, 1, false);
+        }
+
+        void BuildTable(int resolution) {
+            if (segments.empty()) {
+                distanceToParameter.clear();
+                length = 0.0f;
+                inverseStep = 0.0f;
+                return;
+            }
+            size_t sampleCount = segments.size() * resolution + 1;
+
+            // cumulative length at uniformly spaced parameters
+            std::vector<float> cumulative(sampleCount);
+            cumulative[0] = 0.0f;
+            FastVector3 previous = segments[0].Evaluate(0.0f);
+            float invResolution = 1.0f / static_cast<float>(resolution);
+            for (size_t i = 1; i < sampleCount; i++) {
+                size_t segment = (i - 1) / resolution;
+                float t = static_cast<float>(i - segment * resolution) * invResolution;
+                FastVector3 current = segments[segment].Evaluate(t);
+                cumulative[i] = cumulative[i - 1] + previous.Distance(current);
+                previous = current;
+            }
+            length = cumulative.back();
+
+            // invert it into a table uniformly spaced in distance, both are monotonic so walk them together
+            distanceToParameter.resize(sampleCount);
+            if (length <= 0.0f) {
+                std::fill(distanceToParameter.begin(), distanceToParameter.end(), 0.0f);
+                inverseStep = 0.0f;
+                return;
+            }
+            float step = length / static_cast<float>(sampleCount - 1);
+            inverseStep = 1.0f / step;
+            size_t j = 0;
+            for (size_t i = 0; i < sampleCount; i++) {
+                float target = step * static_cast<float>(i);
+                while (j + 2 < sampleCount && cumulative[j + 1] < target) j++;
+                float span = cumulative[j + 1] - cumulative[j];
+                float frac = span > 0.0f ? Clamp01((target - cumulative[j]) / span) : 0.0f;
+                distanceToParameter[i] = (static_cast<float>(j) + frac) * invResolution;
+            }
+        }
+
+        struct Location {
+            size_t segment;
+            float t;
+        };
+
+        Location Locate(float distance) const {
+            if (distanceToParameter.empty()) return {0, 0.0f};
+            if (loop && length > 0.0f) {
+                distance = std::fmod(distance, length);
+                if (distance < 0.0f) distance += length;
+            } else {
+                distance = std::clamp(distance, 0.0f, length);
+            }
+
+            float f = distance * inverseStep;
+            size_t last = distanceToParameter.size() - 1;
+            size_t index = std::min(static_cast<size_t>(f), last);
+            float parameter = distanceToParameter[index];
+            if (index < last) {
+                float frac = f - static_cast<float>(index);
+                parameter += (distanceToParameter[index + 1] - parameter) * frac;
+            }
+
+            size_t segment = std::min(static_cast<size_t>(parameter), segments.size() - 1);
+            return {segment, parameter - static_cast<float>(segment)};
+        }
+    };
+}
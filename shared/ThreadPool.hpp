@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Sombrero {
+
+    // Fixed set of worker threads for data parallel loops.
+    // ParallelFor gives every participating thread its own contiguous run of indices. A thread takes indices from its
+    // own run and, once that is used up, from the runs of the others, so uneven work evens out without locks on the
+    // hot path. The calling thread always takes part, which keeps nested ParallelFor calls from deadlocking.
+    // Workers are plain threads, not attached to il2cpp, so loop bodies must not touch managed objects.
+    class ThreadPool {
+        public:
+        explicit ThreadPool(size_t threadCount = DefaultThreadCount()) {
+            workers.reserve(threadCount);
+            for (size_t i = 0; i < threadCount; i++) workers.emplace_back([this] { WorkerLoop(); });
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        /// Number of worker threads, not counting the threads that call ParallelFor
+        size_t ThreadCount() const {
+            return workers.size();
+        }
+
+        /// One less than the hardware threads, since the caller works too
+        static size_t DefaultThreadCount() {
+            unsigned hardware = std::thread::hardware_concurrency();
+            return hardware > 1 ? hardware - 1 : 0;
+        }
+
+        /// Pool used when nothing else is given, started on first use
+        static ThreadPool& Shared() {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        /**
+         * Calls @param fn with every index in [0, @param count), in no particular order, and returns once all calls finished.
+         * fn is called from several threads at once. If a call throws, indices not started yet are skipped and the first
+         * exception is rethrown here once every thread has let go of the job.
+         * @param degree most threads working on this, the caller included. 0 uses the whole pool
+         */
+        template<typename F>
+        void ParallelFor(size_t count, F&& fn, size_t degree = 0) {
+            size_t laneCount = std::min(count, workers.size() + 1);
+            if (degree != 0) laneCount = std::min(laneCount, degree);
+            if (laneCount <= 1) {
+                for (size_t i = 0; i < count; i++) fn(i);
+                return;
+            }
+
+            using Fn = std::remove_reference_t<F>;
+            Job job(count, laneCount, [](void* context, size_t index) { (*static_cast<Fn*>(context))(index); },
+                    const_cast<void*>(static_cast<void const*>(std::addressof(fn))));
+            {
+                std::lock_guard lock(mutex);
+                jobs.push_back(&job);
+            }
+            {
+                // job lives on this stack, so however this scope is left no worker may still see it
+                JobScope scope{ *this, job };
+                for (size_t i = 1; i < laneCount; i++) wake.notify_one();
+                RunLane(job, 0);
+            }
+            if (job.error) std::rethrow_exception(job.error);
+        }
+
+        private:
+        struct Lane {
+            // own cache line, every thread hammers these
+            alignas(64) std::atomic<size_t> next;
+            size_t end;
+        };
+
+        struct Job {
+            void (*run)(void*, size_t);
+            void* context;
+            std::unique_ptr<Lane[]> lanes;
+            size_t laneCount;
+            // both guarded by the pool mutex. Lane 0 belongs to the caller
+            size_t joined = 1;
+            size_t active = 0;
+            // set once a call threw, the first thread to set it stores the exception
+            std::atomic<bool> failed = false;
+            std::exception_ptr error;
+
+            Job(size_t count, size_t laneCount, void (*run)(void*, size_t), void* context)
+                : run(run), context(context), lanes(new Lane[laneCount]), laneCount(laneCount) {
+                for (size_t i = 0; i < laneCount; i++) {
+                    lanes[i].next.store(count * i / laneCount, std::memory_order_relaxed);
+                    lanes[i].end = count * (i + 1) / laneCount;
+                }
+            }
+        };
+
+        // Takes the job out of the queue and waits for the workers still running it
+        struct JobScope {
+            ThreadPool& pool;
+            Job& job;
+
+            ~JobScope() {
+                std::unique_lock lock(pool.mutex);
+                pool.jobs.erase(std::find(pool.jobs.begin(), pool.jobs.end(), &job));
+                pool.finished.wait(lock, [this] { return job.active == 0; });
+            }
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<Job*> jobs;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        bool stopping = false;
+
+        static void RunLane(Job& job, size_t lane) {
+            try {
+                // own run first, then help the others
+                for (size_t i = 0; i < job.laneCount; i++) {
+                    Lane& run = job.lanes[(lane + i) % job.laneCount];
+                    for (size_t index; (index = run.next.fetch_add(1, std::memory_order_relaxed)) < run.end;) {
+                        if (job.failed.load(std::memory_order_relaxed)) return;
+                        job.run(job.context, index);
+                    }
+                }
+            } catch (...) {
+                // read by the caller after every thread left the job, which the pool mutex orders
+                if (!job.failed.exchange(true)) job.error = std::current_exception();
+            }
+        }
+
+        Job* FindOpenJob() const {
+            for (Job* job : jobs) {
+                if (job->joined < job->laneCount) return job;
+            }
+            return nullptr;
+        }
+
+        void WorkerLoop() {
+            std::unique_lock lock(mutex);
+            while (true) {
+                wake.wait(lock, [this] { return stopping || FindOpenJob(); });
+                if (stopping) return;
+
+                Job* job = FindOpenJob();
+                size_t lane = job->joined++;
+                job->active++;
+                lock.unlock();
+                RunLane(*job, lane);
+                lock.lock();
+                if (--job->active == 0) finished.notify_all();
+            }
+        }
+    };
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Vector3Utils.hpp"
+#include "SplineUtils.hpp"
+#include "RingBuffer.hpp"
+
+#include <array>
+#include <span>
+
+namespace Sombrero {
+
+    struct TrailSample {
+        FastVector3 tip;
+        FastVector3 base;
+        float time;
+    };
+
+    // Saber trail history.
+    // The input thread pushes raw samples through a lock free queue,
+    // the render thread calls Update() which smooths only the newly added segments with Catmull-Rom
+    // and hands back a contiguous view of the smoothed trail, oldest first.
+    // Nothing is allocated after construction, so keep it as a member rather than on the stack.
+    /// @tparam Length how many raw samples of history are kept
+    /// @tparam Subdivisions smoothed points generated per raw segment
+    /// @tparam QueueCapacity how many samples the input thread may get ahead of the render thread
+    template<size_t Length, size_t Subdivisions = 4, size_t QueueCapacity = 64>
+    requires (Length >= 2 && Subdivisions >= 1)
+    class TrailBuffer {
+    public:
+        // Maximum amount of smoothed points visible at once
+        constexpr static size_t SmoothedCapacity = (Length - 1) * Subdivisions + 1;
+
+        /// Input thread. Returns false if the render thread hasn't kept up and the sample was dropped
+        bool Push(FastVector3 const& tip, FastVector3 const& base, float time) {
+            return queue.TryPush({tip, base, time});
+        }
+
+        /// Render thread. Consumes everything pushed so far and returns the smoothed trail
+        std::span<TrailSample const> Update() {
+            queue.Drain([this](TrailSample const& sample) { Append(sample); });
+            return GetSmoothed();
+        }
+
+        /// Render thread. Smoothed trail as of the last Update(), oldest first.
+        /// The view points into the buffer, so it is only valid until the next Update()/Clear()
+        std::span<TrailSample const> GetSmoothed() const {
+            size_t count = std::min(written, SmoothedCapacity);
+            size_t start = (written - count) % Slots;
+            return std::span<TrailSample const>(smoothed.data() + start, count);
+        }
+
+        /// Render thread. Forgets the history, pending pushes are kept
+        void Clear() {
+            controlCount = 0;
+            written = 0;
+        }
+
+    private:
+        // The last segment is rewritten once its next control point arrives,
+        // keep room for it on top of what is visible
+        constexpr static size_t Slots = SmoothedCapacity + Subdivisions;
+
+        SPSCRingBuffer<TrailSample, QueueCapacity> queue;
+
+        // last four raw samples, enough for one Catmull-Rom segment
+        std::array<TrailSample, 4> controls{};
+        size_t controlCount = 0;
+
+        // Every slot is written twice, at i and i + Slots, so any window of up to Slots
+        // consecutive points is contiguous without copying
+        std::array<TrailSample, Slots * 2> smoothed{};
+        // total smoothed points produced, also the index one past the newest one
+        size_t written = 0;
+
+        void Write(size_t index, TrailSample const& sample) {
+            size_t slot = index % Slots;
+            smoothed[slot] = sample;
+            smoothed[slot + Slots] = sample;
+        }
+
+        TrailSample const& Control(size_t i) const {
+            return controls[i % controls.size()];
+        }
+
+        // Writes the Subdivisions points of the segment from control i to i + 1,
+        // with the neighbours given explicitly so the ends can be extrapolated
+        void WriteSegment(size_t i, TrailSample const& p0, TrailSample const& p1, TrailSample const& p2, TrailSample const& p3) {
+            auto tip = CubicSegment::CatmullRom(p0.tip, p1.tip, p2.tip, p3.tip);
+            auto base = CubicSegment::CatmullRom(p0.base, p1.base, p2.base, p3.base);
+
+            constexpr float step = 1.0f / static_cast<float>(Subdivisions);
+            for (size_t s = 0; s < Subdivisions; s++) {
+                float t = step * static_cast<float>(s);
+                Write(i * Subdivisions + s, {tip.Evaluate(t), base.Evaluate(t), p1.time + (p2.time - p1.time) * t});
+            }
+        }
+
+        static TrailSample Extrapolate(TrailSample const& from, TrailSample const& towards) {
+            return {towards.tip * 2.0f - from.tip, towards.base * 2.0f - from.base, towards.time * 2.0f - from.time};
+        }
+
+        void Append(TrailSample const& sample) {
+            size_t n = controlCount;
+            controls[n % controls.size()] = sample;
+            controlCount = n + 1;
+
+            if (n >= 1) {
+                // segment n - 2 -> n - 1 now knows its real end neighbour, finalize it
+                if (n >= 2) {
+                    TrailSample p0 = n >= 3 ? Control(n - 3) : Extrapolate(Control(n - 1), Control(n - 2));
+                    WriteSegment(n - 2, p0, Control(n - 2), Control(n - 1), Control(n));
+                }
+                // newest segment, end neighbour is extrapolated until the next sample arrives
+                TrailSample p0 = n >= 2 ? Control(n - 2) : Extrapolate(Control(n), Control(n - 1));
+                WriteSegment(n - 1, p0, Control(n - 1), Control(n), Extrapolate(Control(n - 1), Control(n)));
+            }
+
+            // the trail always ends exactly on the newest sample
+            Write(n * Subdivisions, sample);
+            written = n * Subdivisions + 1;
+        }
+    };
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "Vector3Utils.hpp"
+#include "QuaternionUtils.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace Sombrero {
+
+    // Native stand in for a tree of Unity Transforms.
+    // Nodes are stored flat with every parent before its children, so world transforms
+    // can be rebuilt in a single forward pass. Only nodes at or after the first dirty one are visited,
+    // and only dirty nodes (or children of dirty nodes) are recomputed, so nothing is done for static geometry.
+    // World scale is the product of local scales, same as Unity's lossyScale.
+    class TransformHierarchy {
+    public:
+        using Index = uint32_t;
+        constexpr static Index NoParent = UINT32_MAX;
+
+        TransformHierarchy() = default;
+
+        void reserve(size_t count) {
+            parents.reserve(count);
+            localPositions.reserve(count);
+            localRotations.reserve(count);
+            localScales.reserve(count);
+            worldPositions.reserve(count);
+            worldRotations.reserve(count);
+            worldScales.reserve(count);
+            dirty.reserve(count);
+        }
+
+        size_t size() const {
+            return parents.size();
+        }
+
+        void clear() {
+            parents.clear();
+            localPositions.clear();
+            localRotations.clear();
+            localScales.clear();
+            worldPositions.clear();
+            worldRotations.clear();
+            worldScales.clear();
+            dirty.clear();
+            firstDirty = NoParent;
+        }
+
+        /// Adds a node. The parent has to be added first, which is what keeps the storage ordered
+        /// @return the index of the new node, used by every other call
+        Index Add(Index parent, FastVector3 const& localPosition = {}, FastQuaternion const& localRotation = FastQuaternion::identity(), FastVector3 const& localScale = FastVector3::one()) {
+            auto index = static_cast<Index>(parents.size());
+            if (parent >= index) parent = NoParent;
+
+            parents.push_back(parent);
+            localPositions.push_back(localPosition);
+            localRotations.push_back(localRotation);
+            localScales.push_back(localScale);
+            worldPositions.emplace_back();
+            worldRotations.emplace_back();
+            worldScales.emplace_back();
+            dirty.push_back(true);
+            MarkDirty(index);
+            return index;
+        }
+
+        Index GetParent(Index index) const {
+            return parents[index];
+        }
+
+        FastVector3 const& GetLocalPosition(Index index) const {
+            return localPositions[index];
+        }
+
+        FastQuaternion const& GetLocalRotation(Index index) const {
+            return localRotations[index];
+        }
+
+        FastVector3 const& GetLocalScale(Index index) const {
+            return localScales[index];
+        }
+
+        void SetLocalPosition(Index index, FastVector3 const& position) {
+            localPositions[index] = position;
+            MarkDirty(index);
+        }
+
+        void SetLocalRotation(Index index, FastQuaternion const& rotation) {
+            localRotations[index] = rotation;
+            MarkDirty(index);
+        }
+
+        void SetLocalScale(Index index, FastVector3 const& scale) {
+            localScales[index] = scale;
+            MarkDirty(index);
+        }
+
+        void SetLocal(Index index, FastVector3 const& position, FastQuaternion const& rotation, FastVector3 const& scale) {
+            localPositions[index] = position;
+            localRotations[index] = rotation;
+            localScales[index] = scale;
+            MarkDirty(index);
+        }
+
+        // World getters update lazily, the first call after a change pays for the whole pass
+        FastVector3 const& GetWorldPosition(Index index) {
+            UpdateWorldTransforms();
+            return worldPositions[index];
+        }
+
+        FastQuaternion const& GetWorldRotation(Index index) {
+            UpdateWorldTransforms();
+            return worldRotations[index];
+        }
+
+        FastVector3 const& GetWorldScale(Index index) {
+            UpdateWorldTransforms();
+            return worldScales[index];
+        }
+
+        /// Local space point of index to world space
+        FastVector3 TransformPoint(Index index, FastVector3 const& point) {
+            UpdateWorldTransforms();
+            return worldPositions[index] + worldRotations[index] * (worldScales[index] * point);
+        }
+
+        /// Local space direction of index to world space, unaffected by position and scale
+        FastVector3 TransformDirection(Index index, FastVector3 const& direction) {
+            UpdateWorldTransforms();
+            return worldRotations[index] * direction;
+        }
+
+        bool IsDirty() const {
+            return firstDirty != NoParent;
+        }
+
+        /// Recomputes world transforms of every changed node and its descendants, no-op if nothing changed
+        void UpdateWorldTransforms() {
+            if (firstDirty == NoParent) return;
+
+            size_t count = parents.size();
+            for (size_t i = firstDirty; i < count; i++) {
+                Index parent = parents[i];
+                // parents were handled earlier in this same pass, so their flag already includes their ancestors
+                if (parent != NoParent && dirty[parent]) dirty[i] = true;
+                if (!dirty[i]) continue;
+
+                if (parent == NoParent) {
+                    worldPositions[i] = localPositions[i];
+                    worldRotations[i] = localRotations[i];
+                    worldScales[i] = localScales[i];
+                } else {
+                    worldPositions[i] = worldPositions[parent] + worldRotations[parent] * (worldScales[parent] * localPositions[i]);
+                    worldRotations[i] = worldRotations[parent] * localRotations[i];
+                    worldScales[i] = worldScales[parent] * localScales[i];
+                }
+            }
+
+            std::fill(dirty.begin() + firstDirty, dirty.end(), false);
+            firstDirty = NoParent;
+        }
+
+    private:
+        std::vector<Index> parents;
+        std::vector<FastVector3> localPositions;
+        std::vector<FastQuaternion> localRotations;
+        std::vector<FastVector3> localScales;
+        std::vector<FastVector3> worldPositions;
+        std::vector<FastQuaternion> worldRotations;
+        std::vector<FastVector3> worldScales;
+        // uint8_t rather than bool, vector<bool> packs bits
+        std::vector<uint8_t> dirty;
+        // lowest dirty index, or NoParent when everything is clean
+        Index firstDirty = NoParent;
+
+        void MarkDirty(Index index) {
+            dirty[index] = true;
+            if (firstDirty == NoParent || index < firstDirty) firstDirty = index;
+        }
+    };
+}
@@ -196,8 +196,7 @@ namespace std {
     {
         size_t operator()(const Sombrero::FastVector2 & v) const
         {
-            std::hash<float> h;
-            return h(v.x) ^ h(v.y);
+            return Sombrero::HashFloats(v.x, v.y);
         }
     };
 }
\ No newline at end of file
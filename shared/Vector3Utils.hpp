@@ -140,6 +140,11 @@ namespace Sombrero {
 			return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
 		}
 
+        static constexpr FastVector3 Cross(FastVector3 const& lhs, FastVector3 const& rhs)
+        {
+            return FastVector3(lhs.y * rhs.z - lhs.z * rhs.y, lhs.z * rhs.x - lhs.x * rhs.z, lhs.x * rhs.y - lhs.y * rhs.x);
+        }
+
 #define operatorOverload(name, operatore) \
         constexpr FastVector3 operator operatore(const FastVector3& b) const { \
             return FastVector3(this->x operatore b.x, this->y operatore b.y, this->z operatore b.z); \
@@ -226,8 +231,7 @@ namespace std {
     {
         size_t operator()(const Sombrero::FastVector3 & v) const
         {
-            std::hash<float> h;
-            return h(v.x) ^ h(v.y) ^ h(v.z);
+            return Sombrero::HashFloats(v.x, v.y, v.z);
         }
     };
 }
\ No newline at end of file
@@ -3,13 +3,52 @@
 #include <concepts>
 #include <type_traits>
 #include "Concepts.hpp"
+#include "FlatHashMap.hpp"
+#include "SmallVector.hpp"
+#include "ThreadPool.hpp"
 #include "beatsaber-hook/shared/utils/typedefs-array.hpp"
 #include <optional>
 #include <iterator>
 #include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <array>
+#include <vector>
+#include <bit>
+#include <span>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <ranges>
+
+namespace Sombrero {
+    struct FastVector2;
+    struct FastVector3;
+    struct FastColor;
+    struct FastQuaternion;
+}
 
 namespace Sombrero::Linq {
 
+    // Lazy results such as Reverse, Take, Zip, Concat, Memoize, the fused pipeline and ParallelQuery hold their sources the same way:
+    // a temporary source is moved inside, a named one is referenced and has to outlive the result.
+    // Overloads taking a std::pmr::memory_resource* allocate from it, and nullptr means the heap.
+
+    /// Types made of nothing but float components, which Sum and Average add component by component.
+    /// Specialize it for other all float structs to get the same treatment
+    template<class T>
+    constexpr bool is_float_vector = false;
+
+    template<> constexpr bool is_float_vector<FastVector2> = true;
+    template<> constexpr bool is_float_vector<FastVector3> = true;
+    template<> constexpr bool is_float_vector<FastColor> = true;
+    template<> constexpr bool is_float_vector<FastQuaternion> = true;
+
     template <class From, class To>
     concept convertible_to =
         std::is_convertible_v<From, To> &&
@@ -65,6 +104,107 @@ namespace Sombrero::Linq {
         }
     }
 
+    /// How many elements a range produces, when that is known without walking it
+    struct SizeHint {
+        size_t count;
+        // otherwise count is only an upper bound, SIZE_MAX when nothing is known
+        bool exact;
+    };
+
+    template<class T>
+    concept has_size_hint = requires (T const& t) {
+        {t.size_hint()} -> Sombrero::Linq::convertible_to<SizeHint>;
+    };
+
+    template<class T>
+    requires (range<T>)
+    SizeHint GetSizeHint(T const& range) {
+        if constexpr (can_get_size<T const&>) {
+            return { static_cast<size_t>(get_size(range)), true };
+        } else if constexpr (has_size_hint<T>) {
+            return range.size_hint();
+        } else {
+            return { SIZE_MAX, false };
+        }
+    }
+
+    namespace detail {
+        template<class T>
+        concept assignable_member = std::is_object_v<T>
+            && (!std::is_copy_constructible_v<T> || std::is_copy_assignable_v<T>)
+            && (!std::is_move_constructible_v<T> || std::is_move_assignable_v<T>);
+
+        // Member of an iterable that holds a source or a function, reached with * and ->.
+        // A referenced source is kept as a pointer, so assigning the iterable rebinds it like std views do.
+        // Something that can be built but not assigned, like a lambda with captures, sits in an optional and is
+        // rebuilt in place, as std views do with their functions. Either way the iterable keeps defaulted assignment,
+        // so it is movable and std::views adaptors can take it by value
+        template<class T>
+        class Stored {
+            public:
+            template<class U>
+            requires (!std::is_same_v<std::remove_cvref_t<U>, Stored>)
+            explicit Stored(U&& value) : value(std::in_place, std::forward<U>(value)) {}
+
+            Stored(Stored const&) = default;
+            Stored(Stored&&) = default;
+
+            // if the copy throws the box is left empty, not half destroyed
+            Stored& operator=(Stored const& other) {
+                if (this != &other) {
+                    if (other.value) value.emplace(*other.value);
+                    else value.reset();
+                }
+                return *this;
+            }
+
+            Stored& operator=(Stored&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+                if (this != &other) {
+                    if (other.value) value.emplace(std::move(*other.value));
+                    else value.reset();
+                }
+                return *this;
+            }
+
+            T& operator*() { return *value; }
+            T const& operator*() const { return *value; }
+            T* operator->() { return std::addressof(*value); }
+            T const* operator->() const { return std::addressof(*value); }
+
+            private:
+            std::optional<T> value;
+        };
+
+        template<class T>
+        requires (assignable_member<T>)
+        class Stored<T> {
+            public:
+            template<class U>
+            requires (!std::is_same_v<std::remove_cvref_t<U>, Stored>)
+            explicit Stored(U&& value) : value(std::forward<U>(value)) {}
+
+            T& operator*() { return value; }
+            T const& operator*() const { return value; }
+            T* operator->() { return std::addressof(value); }
+            T const* operator->() const { return std::addressof(value); }
+
+            private:
+            T value;
+        };
+
+        template<class T>
+        class Stored<T&> {
+            public:
+            explicit Stored(T& value) : pointer(std::addressof(value)) {}
+
+            T& operator*() const { return *pointer; }
+            T* operator->() const { return pointer; }
+
+            private:
+            T* pointer;
+        };
+    }
+
     template<class I, class F>
     requires (input_iterator<I>)
     struct WhereIterable {
@@ -72,17 +212,19 @@ namespace Sombrero::Linq {
         I start;
         I last;
         using T = decltype(*start);
-        F function;
+        detail::Stored<F> function;
         public:
         struct WhereIterator {
-            explicit WhereIterator(WhereIterable const& v, I iter) : iterable(v), iterator(iter) {
+            WhereIterator() = default;
+            explicit WhereIterator(WhereIterable const& v, I iter) : iterable(&v), iterator(iter) {
                 // Start by finding the first match
-                while (iterator != iterable.last && !iterable.function(*iterator)) {
+                while (iterator != iterable->last && !(*iterable->function)(*iterator)) {
                     ++iterator;
                 }
-                // If we walk all the way to the end, iterator == iterable.last
+                // If we walk all the way to the end, iterator == iterable->last
             }
-            T& operator*() const {
+            // T is a reference unless the source makes values, like a Select does
+            T operator*() const {
                 return *iterator;
             }
             // ptrdiff_t can't be used for this type, since we can't know the distance.
@@ -91,18 +233,17 @@ namespace Sombrero::Linq {
             using pointer = typename std::iterator_traits<I>::pointer;
             using reference = typename std::iterator_traits<I>::reference;
             using iterator_category = std::forward_iterator_tag;
-            __attribute__((noinline))
             WhereIterator& operator++() {
                 // Move first, then compare.
-                while (++iterator != iterable.last) {
-                    if (iterable.function(*iterator)) {
+                while (++iterator != iterable->last) {
+                    if ((*iterable->function)(*iterator)) {
                         break;
                     }
                 }
                 return *this;
             }
             WhereIterator operator++(int) {
-                WhereIterator ret(iterable, iterator);
+                WhereIterator ret = *this;
                 this->operator++();
                 return ret;
             }
@@ -110,8 +251,8 @@ namespace Sombrero::Linq {
                 return iterator == other.iterator;
             }
             private:
-            WhereIterable const& iterable;
-            I iterator;
+            WhereIterable const* iterable = nullptr;
+            I iterator = {};
         };
         auto begin() const {
             return WhereIterator(*this, start);
@@ -120,53 +261,130 @@ namespace Sombrero::Linq {
             return WhereIterator(*this, last);
         }
 
+        /// At most as many elements as the source
+        SizeHint size_hint() const {
+            return { bound, false };
+        }
+
         using iterator = WhereIterator;
 
         template<class R>
         requires (range<R>)
-        explicit WhereIterable(R&& range, F&& func) : start(range.begin()), last(range.end()), function(func) {}
+        explicit WhereIterable(R&& range, F&& func) : start(range.begin()), last(range.end()), function(func), bound(GetSizeHint(range).count) {}
+
+        private:
+        size_t bound;
     };
 
     template<class R, class F>
     requires (range<R>)
     WhereIterable(R&& r, F&&) -> WhereIterable<decltype(r.begin()), F>;
 
-    template<class I, class F, class R>
+    namespace detail {
+        // Category of an iterator that reads through I, capped at random access since the values it makes aren't contiguous
+        template<class I>
+        using propagated_category_t = std::conditional_t<std::random_access_iterator<I>, std::random_access_iterator_tag,
+                                      std::conditional_t<std::bidirectional_iterator<I>, std::bidirectional_iterator_tag, std::forward_iterator_tag>>;
+    }
+
+    // With Cache, each iterator keeps the value it points at, so dereferencing it again, as a Where after it does,
+    // doesn't run the function again.
+    // Without it the iterators move like the source's, so a Select over an array keeps O(1) size, indexing and Reverse
+    template<class I, class F, class R, bool Cache = false>
     requires (input_iterator<I>)
     struct SelectIterable {
         private:
         I start;
         I last;
-        F function;
+        detail::Stored<F> function;
+        // a function returning a reference is already cheap to call again
+        constexpr static bool Caches = Cache && !std::is_reference_v<R>;
+        // a cached value lives in the iterator, and reverse_iterator reads through a temporary copy, so caching stays forward only
+        constexpr static bool Bidirectional = !Caches && std::bidirectional_iterator<I>;
+        constexpr static bool RandomAccess = !Caches && std::random_access_iterator<I>;
+        struct NoCache {};
         public:
         struct SelectIterator {
-            explicit SelectIterator(SelectIterable const& v, I iter) : iterable(v), iterator(iter) {}
+            SelectIterator() = default;
+            explicit SelectIterator(SelectIterable const& v, I iter) : iterable(&v), iterator(iter) {}
             // TODO: Add support for function being invoked with index
             // TODO: Do we want to evaluate on * or have * always be post-evaluation?
             // Unclear which makes more sense.
-            R operator*() const {
-                return iterable.function(*iterator);
+            decltype(auto) operator*() const {
+                if constexpr (Caches) {
+                    if (!current) current.emplace((*iterable->function)(*iterator));
+                    return static_cast<R const&>(*current);
+                } else {
+                    return (*iterable->function)(*iterator);
+                }
             }
-            // Actually has value for this type
-            // TODO: Create - operators
             using difference_type = std::ptrdiff_t;
-            using value_type = R;
+            using value_type = std::remove_cvref_t<R>;
             using pointer = void;
-            using reference = R&;
-            using iterator_category = std::forward_iterator_tag;
+            using reference = std::conditional_t<Caches, R const&, R>;
+            using iterator_category = std::conditional_t<Caches, std::forward_iterator_tag, detail::propagated_category_t<I>>;
             SelectIterator& operator++() {
                 ++iterator;
+                if constexpr (Caches) current.reset();
                 return *this;
             }
             SelectIterator operator++(int) {
-                return SelectIterator(iterable, iterator++);
+                SelectIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            SelectIterator& operator--() requires (Bidirectional) {
+                --iterator;
+                return *this;
+            }
+            SelectIterator operator--(int) requires (Bidirectional) {
+                SelectIterator ret = *this;
+                --iterator;
+                return ret;
+            }
+            SelectIterator& operator+=(difference_type n) requires (RandomAccess) {
+                iterator += n;
+                return *this;
+            }
+            SelectIterator& operator-=(difference_type n) requires (RandomAccess) {
+                iterator -= n;
+                return *this;
+            }
+            SelectIterator operator+(difference_type n) const requires (RandomAccess) {
+                return SelectIterator(*iterable, iterator + n);
+            }
+            friend SelectIterator operator+(difference_type n, SelectIterator const& it) requires (RandomAccess) {
+                return it + n;
+            }
+            SelectIterator operator-(difference_type n) const requires (RandomAccess) {
+                return SelectIterator(*iterable, iterator - n);
+            }
+            difference_type operator-(SelectIterator const& other) const requires (RandomAccess) {
+                return iterator - other.iterator;
+            }
+            // projects only the element asked for
+            reference operator[](difference_type n) const requires (RandomAccess) {
+                return (*iterable->function)(iterator[n]);
             }
             bool operator==(SelectIterator const& other) const {
                 return iterator == other.iterator;
             }
+            bool operator<(SelectIterator const& other) const requires (RandomAccess) {
+                return iterator < other.iterator;
+            }
+            bool operator>(SelectIterator const& other) const requires (RandomAccess) {
+                return iterator > other.iterator;
+            }
+            bool operator<=(SelectIterator const& other) const requires (RandomAccess) {
+                return iterator <= other.iterator;
+            }
+            bool operator>=(SelectIterator const& other) const requires (RandomAccess) {
+                return iterator >= other.iterator;
+            }
             private:
-            SelectIterable const& iterable;
-            I iterator;
+            SelectIterable const* iterable = nullptr;
+            I iterator = {};
+            [[no_unique_address]] mutable std::conditional_t<Caches, std::optional<R>, NoCache> current;
         };
         auto begin() const {
             return SelectIterator(*this, start);
@@ -175,196 +393,3383 @@ namespace Sombrero::Linq {
             return SelectIterator(*this, last);
         }
 
+        /// One element per source element
+        SizeHint size_hint() const {
+            return hint;
+        }
+
+        /// O(1) for random access sources
+        size_t size() const requires (std::random_access_iterator<I>) {
+            return last - start;
+        }
+
+        /// Projects only the element at @param index
+        decltype(auto) operator[](size_t index) const requires (std::random_access_iterator<I>) {
+            return (*function)(start[index]);
+        }
+
         using iterator = SelectIterator;
 
         template<class Range>
         requires (range<Range>)
-        explicit SelectIterable(Range&& range, F&& func) : start(range.begin()), last(range.end()), function(func) {}
+        explicit SelectIterable(Range&& range, F&& func) : start(range.begin()), last(range.end()), function(func), hint(GetSizeHint(range)) {}
+
+        private:
+        SizeHint hint;
     };
 
     template<class Range, class F>
     requires (range<Range>)
     SelectIterable(Range&& r, F&& func) -> SelectIterable<decltype(r.begin()), F, decltype(func(*r.begin()))>;
 
+    /**
+     * Result of Memoize. Pulls from the source only as far as it is iterated and keeps every element it pulled, so each element,
+     * and any Select projection feeding it, is evaluated once however often this is iterated.
+     * The source is kept alive inside, copies share the cache. Not thread safe
+     */
+    template<class Source>
+    class MemoizedIterable {
+        using SourceIterator = decltype(std::declval<Source&>().begin());
+        public:
+        using value_type = std::remove_cvref_t<decltype(*std::declval<SourceIterator&>())>;
 
-    template<typename T, typename Iterator = typename T::iterator>
-    concept ConstIterable = requires(T const& t, int length, Iterator it) {
-        {T() -> SomberoConvertible<T>};
-        {T(length) -> SomberoConvertible<T>};
-        {T(it, it) -> SomberoConvertible<T>};
-        {t.begin()};
-        {t.end()};
-        {t.size()};
-    } && std::is_copy_constructible_v<T> && std::is_copy_assignable_v<T>;
+        private:
+        struct State {
+            Source source;
+            std::optional<SourceIterator> cursor;
+            // deque so references handed out stay valid while more elements are pulled
+            std::deque<value_type> cache;
 
-    template<typename T>
-    concept Iterable = ConstIterable<T> && requires(T& t) {
-        {t.begin()};
-        {t.end()};
-    } && std::is_move_constructible_v<T> && std::is_move_assignable_v<T>;
+            template<class T>
+            explicit State(T&& source) : source(std::forward<T>(source)) {}
 
+            // Pulls from the source until index is cached. False if the source runs out first
+            bool Load(size_t index) {
+                if (index < cache.size()) return true;
+                if (!cursor) cursor.emplace(source.begin());
+                while (cache.size() <= index && *cursor != source.end()) {
+                    cache.push_back(**cursor);
+                    ++*cursor;
+                }
+                return index < cache.size();
+            }
+        };
 
-    /**
-     * Finds all elements that satisfy @param fn
-     * @tparam T
-     * @tparam F
-     * @param list
-     * @param fn
-     * @return
-     */
-    template<class T, typename F>
-    requires (range<T>)
-    auto Where(T const& list, F&& fn) {
-        return WhereIterable(list, fn);
-    }
+        public:
+        struct MemoizedIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = MemoizedIterable::value_type;
+            using pointer = value_type const*;
+            using reference = value_type const&;
+            using iterator_category = std::forward_iterator_tag;
 
-    template<class T, typename F>
-    requires (range<T>)
-    auto Select(T const& list, F&& fn) {
-        return SelectIterable(list, fn);
-    }
+            MemoizedIterator() = default;
+            MemoizedIterator(State* state, size_t index) : state(state), index(index) {}
 
-    template<class T>
-    requires (range<T>)
-    auto Reverse(T&& list) {
-        return std::span(std::rbegin(list), std::rend(list));
-    }
+            reference operator*() const {
+                state->Load(index);
+                return state->cache[index];
+            }
+            MemoizedIterator& operator++() {
+                ++index;
+                return *this;
+            }
+            MemoizedIterator operator++(int) {
+                return MemoizedIterator(state, index++);
+            }
+            bool operator==(MemoizedIterator const& other) const {
+                bool atEnd = AtEnd();
+                return atEnd == other.AtEnd() && (atEnd || index == other.index);
+            }
 
-    template<class T>
-    requires (range<T>)
-    auto ToArray(T&& range) {
-        // TODO: Improve this using better concepts
-        // We can block copy if we satisfy contiguous iterator
-        // So, this is actually kind of interesting.
-        // If we can compute the distance (ex, we can easily tell how large our collection is)
-        // Then we should do that
-        // Otherwise, we kinda have to make a vector then shrink it and be good to go
-        using ItemT = std::remove_reference_t<decltype(*range.begin())>;
-        if constexpr (can_get_size<T>) {
-            ArrayW<ItemT> arr(get_size<T>(std::forward<T>(range)));
-            std::copy(range.begin(), range.end(), arr.begin());
-            return arr;
+            private:
+            constexpr static size_t End = SIZE_MAX;
+            State* state = nullptr;
+            size_t index = End;
+
+            bool AtEnd() const {
+                return index == End || !state->Load(index);
+            }
+
+            friend class MemoizedIterable;
+        };
+
+        using iterator = MemoizedIterator;
+
+        template<class T>
+        requires (!std::is_same_v<std::remove_cvref_t<T>, MemoizedIterable>)
+        explicit MemoizedIterable(T&& source) : state(std::make_shared<State>(std::forward<T>(source))) {}
+
+        MemoizedIterator begin() const {
+            return MemoizedIterator(state.get(), 0);
         }
-        // We don't know how to get the size, lets copy into a buffer
-        // Then copy to our array.
-        // TODO: We use a vector. vector<bool> will break.
-        std::vector<ItemT> vec(range.begin(), range.end());
-        ArrayW<ItemT> arr(vec.size());
-        std::copy(vec.begin(), vec.end(), arr.begin());
-        return arr;
-    }
 
-    template<class T>
-    requires (range<T>)
-    auto Count(T&& range) {
-        // TODO: Improve this using better concepts
-        // We can block copy if we satisfy contiguous iterator
-        // So, this is actually kind of interesting.
-        // If we can compute the distance (ex, we can easily tell how large our collection is)
-        // Then we should do that
-        // Otherwise, we kinda have to make a vector then shrink it and be good to go
-        using ItemT = std::remove_reference_t<decltype(*range.begin())>;
-        if constexpr (can_get_size<T>) {
-            return get_size<T>(std::forward<T>(range));
+        MemoizedIterator end() const {
+            return MemoizedIterator(state.get(), MemoizedIterator::End);
         }
-        // We don't know how to get the size, lets copy into a buffer
-        // Then copy to our array.
-        // TODO: We use a vector. vector<bool> will break.
-        std::vector<ItemT> vec(range.begin(), range.end());
-        return vec.size();
-    }
 
-    template<class T>
-    requires (range<T>)
-    auto ToVector(T&& range) {
-        return std::vector(range.begin(), range.end());
-    }
+        /// Same as the source
+        SizeHint size_hint() const {
+            return GetSizeHint(state->source);
+        }
 
-    template<class T>
-    requires (range<T>)
-    auto ToList(T&& range) {
-        using ItemT = std::remove_reference_t<decltype(*range.begin())>;
-        if constexpr (can_get_size<T>) {
-            auto lst = il2cpp_utils::NewSpecific<List<ItemT>*>(get_size<T>(std::forward<T>(range)));
-            // Now that we have a list that is big enough, lets copy to it
-            #ifdef HAS_CODEGEN
-            std::copy(range.begin(), range.end(), lst->items.begin());
-            #else
-            std::copy(range.begin(), range.end(), &lst->items->values[0]);
-            #endif
-            return lst;
+        private:
+        std::shared_ptr<State> state;
+    };
+
+
+    /**
+     * Result of Reverse. Walks a bidirectional source from the back without copying it,
+     * and keeps O(1) size and indexing when the source is random access.
+     * Holds its source as noted at the top of this file
+     */
+    template<class Source>
+    class ReverseIterable {
+        using SourceIterator = decltype(std::declval<Source const&>().begin());
+        public:
+        using iterator = std::reverse_iterator<SourceIterator>;
+        using value_type = std::remove_cvref_t<decltype(*std::declval<SourceIterator&>())>;
+
+        template<class T>
+        requires (!std::is_same_v<std::remove_cvref_t<T>, ReverseIterable>)
+        explicit ReverseIterable(T&& source) : source(std::forward<T>(source)) {}
+
+        iterator begin() const {
+            return iterator(source->end());
         }
-        // We can't get the size, so we have to copy into some buffer and then copy to the list
-        // TODO: We use a vector. vector<bool> will break.
-        std::vector<ItemT> vec(range.begin(), range.end());
-        auto lst = il2cpp_utils::NewSpecific<List<ItemT>*>(vec.size());
-        // Now that we have a list that is big enough, lets copy to it
-        #ifdef HAS_CODEGEN
-        std::copy(vec.begin(), vec.end(), lst->items.begin());
-        #else
-        std::copy(vec.begin(), vec.end(), &lst->items->values[0]);
-        #endif
-        return lst;
-    }
 
-    template<range T, typename F>
-    auto First(T const& list, F&& fn) {
-        using ItemT = std::remove_reference_t<decltype(*list.begin())>;
+        iterator end() const {
+            return iterator(source->begin());
+        }
 
-        for (auto v : list)
-            if (fn(v)) return std::make_optional<ItemT>(v);
+        /// Same as the source
+        SizeHint size_hint() const {
+            return GetSizeHint(*source);
+        }
 
-        return (std::optional<ItemT>) std::nullopt;
-    }
+        size_t size() const requires (std::random_access_iterator<SourceIterator>) {
+            return source->end() - source->begin();
+        }
 
-    template<range T, typename F>
-    auto First(T&& list, F&& fn) {
-        using ItemT = std::remove_reference_t<decltype(*list.begin())>;
+        decltype(auto) operator[](size_t index) const requires (std::random_access_iterator<SourceIterator>) {
+            return begin()[static_cast<std::ptrdiff_t>(index)];
+        }
 
-        for (auto const& v : list)
-            if (fn(v)) return std::make_optional<ItemT>(v);
+        private:
+        detail::Stored<Source> source;
+    };
+    namespace detail {
+        // Moves it up to n steps towards last, in one step for random access iterators
+        template<class I>
+        I AdvanceBounded(I it, size_t n, I const& last) {
+            if constexpr (std::random_access_iterator<I>) {
+                return it + static_cast<std::iter_difference_t<I>>(std::min<size_t>(n, last - it));
+            } else {
+                for (; n != 0 && it != last; n--) ++it;
+                return it;
+            }
+        }
 
-        return (std::optional<ItemT>) std::nullopt;
+        template<class I>
+        using source_iterator_t = decltype(std::declval<I const&>().begin());
     }
 
-    template<typename... TArgs>
-    auto FirstOrDefault(TArgs&&... args) {
-        auto opt = First(std::forward<TArgs>(args)...);
+    /// Part of a range, what Chunk and Window yield when the source isn't contiguous
+    template<class I>
+    struct IteratorRange {
+        I first;
+        I last;
 
-        return opt.template value_or<typename decltype(opt)::value_type>({});
-    }
+        I begin() const {
+            return first;
+        }
 
-    auto Last(auto& list, auto&& fn) {
-        return First(std::span(std::rbegin(list), std::rend(list)), fn);
-    }
+        I end() const {
+            return last;
+        }
 
-    auto Last(auto const& list, auto&& fn) {
-        return First(std::span(std::rbegin(list), std::rend(list)), fn);
-    }
+        size_t size() const requires (std::random_access_iterator<I>) {
+            return last - first;
+        }
+    };
 
-    template<typename... TArgs>
-    auto LastOrDefault(TArgs&&... args) {
-        auto opt = Last(std::forward<TArgs>(args)...);
+    namespace detail {
+        // begin() and end() of a std view as one iterator type
+        template<class I, class S>
+        struct common_iterator_for {
+            using type = std::common_iterator<I, S>;
+        };
 
-        return opt.template value_or<typename decltype(opt)::value_type>({});
+        template<class I>
+        struct common_iterator_for<I, I> {
+            using type = I;
+        };
     }
 
-    template<ConstIterable T, typename F>
-    bool Any(T const& list, F&& fn) {
-        for (auto it = list.begin(); it != list.end(); it++) {
-            if (fn(*it)) return true;
+    /**
+     * A std::ranges view as a Linq source. Linq iterates its sources through const and expects begin() and end() to have
+     * the same type, which views like std::views::filter (only iterable when non const, since they cache their begin)
+     * or an unbounded std::views::iota (which ends in a sentinel) don't provide.
+     * Iterating still fills the view's cache, so like the view itself it must not be iterated from several threads at once
+     */
+    template<std::ranges::view View>
+    class StdViewSource {
+        public:
+        using iterator = typename detail::common_iterator_for<std::ranges::iterator_t<View>, std::ranges::sentinel_t<View>>::type;
+        using value_type = std::ranges::range_value_t<View>;
+
+        explicit StdViewSource(View view) : view(std::move(view)) {}
+
+        iterator begin() const {
+            return iterator(view.begin());
         }
 
-        return false;
-    }
+        iterator end() const {
+            return iterator(view.end());
+        }
 
-    template<ConstIterable T, typename F>
-    bool All(T const& list, F&& fn) {
-        for (auto it = list.begin(); it != list.end(); it++) {
-            if (!fn(*it)) return false;
+        size_t size() const requires (std::ranges::sized_range<View>) {
+            return std::ranges::size(view);
         }
 
-        return true;
+        private:
+        mutable View view;
+    };
+
+    namespace detail {
+        template<class T>
+        concept needs_view_source = std::ranges::viewable_range<T> &&
+            !(std::ranges::range<std::remove_reference_t<T> const> && std::ranges::common_range<std::remove_reference_t<T> const>);
+
+        /// Passes range through unchanged, unless it is a std view Linq can't read directly, which is wrapped in a StdViewSource
+        template<class T>
+        decltype(auto) AdaptSource(T&& range) {
+            if constexpr (needs_view_source<T>) return StdViewSource(std::views::all(std::forward<T>(range)));
+            else return std::forward<T>(range);
+        }
     }
 
-}
\ No newline at end of file
+    /**
+     * Result of Take. Over a random access source this is just the front of it, with the source's own iterators.
+     * Otherwise the iterators count down and stop without advancing the source past the last taken element,
+     * so a Where in front doesn't go looking for a match nobody asked for.
+     * Holds its source as noted at the top of this file
+     */
+    template<class Source>
+    class TakeIterable {
+        using SourceIterator = detail::source_iterator_t<Source>;
+        constexpr static bool RandomAccess = std::random_access_iterator<SourceIterator>;
+
+        public:
+        struct TakeIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = std::iter_value_t<SourceIterator>;
+            using pointer = void;
+            using reference = std::iter_reference_t<SourceIterator>;
+            using iterator_category = std::forward_iterator_tag;
+
+            TakeIterator() = default;
+            TakeIterator(SourceIterator it, SourceIterator last, size_t remaining) : iterator(std::move(it)), last(std::move(last)), remaining(remaining) {}
+
+            reference operator*() const {
+                return *iterator;
+            }
+            TakeIterator& operator++() {
+                if (--remaining != 0) ++iterator;
+                return *this;
+            }
+            TakeIterator operator++(int) {
+                TakeIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            bool operator==(TakeIterator const& other) const {
+                bool atEnd = AtEnd();
+                return atEnd == other.AtEnd() && (atEnd || iterator == other.iterator);
+            }
+
+            private:
+            SourceIterator iterator = {};
+            SourceIterator last = {};
+            size_t remaining = 0;
+
+            bool AtEnd() const {
+                return remaining == 0 || iterator == last;
+            }
+        };
+
+        using iterator = std::conditional_t<RandomAccess, SourceIterator, TakeIterator>;
+        using value_type = std::iter_value_t<SourceIterator>;
+
+        template<class T>
+        explicit TakeIterable(T&& source, size_t count) : source(std::forward<T>(source)), count(count) {}
+
+        iterator begin() const {
+            if constexpr (RandomAccess) return source->begin();
+            else return TakeIterator(source->begin(), source->end(), count);
+        }
+
+        iterator end() const {
+            if constexpr (RandomAccess) return detail::AdvanceBounded(source->begin(), count, source->end());
+            else return TakeIterator(source->end(), source->end(), 0);
+        }
+
+        SizeHint size_hint() const {
+            SizeHint hint = GetSizeHint(*source);
+            return { std::min(hint.count, count), hint.exact };
+        }
+
+        private:
+        detail::Stored<Source> source;
+        size_t count;
+    };
+
+    /**
+     * Result of Skip. Random access sources jump straight to the first element, others walk there each time begin() is called.
+     * The iterators are the source's own
+     */
+    template<class Source>
+    class SkipIterable {
+        using SourceIterator = detail::source_iterator_t<Source>;
+
+        public:
+        using iterator = SourceIterator;
+        using value_type = std::iter_value_t<SourceIterator>;
+
+        template<class T>
+        explicit SkipIterable(T&& source, size_t count) : source(std::forward<T>(source)), count(count) {}
+
+        iterator begin() const {
+            return detail::AdvanceBounded(source->begin(), count, source->end());
+        }
+
+        iterator end() const {
+            return source->end();
+        }
+
+        SizeHint size_hint() const {
+            SizeHint hint = GetSizeHint(*source);
+            if (hint.count == SIZE_MAX) return hint;
+            return { hint.count > count ? hint.count - count : 0, hint.exact };
+        }
+
+        private:
+        detail::Stored<Source> source;
+        size_t count;
+    };
+
+    /// Result of TakeWhile. Stops at the first element that fails the predicate, which is checked once per element
+    template<class Source, class F>
+    class TakeWhileIterable {
+        using SourceIterator = detail::source_iterator_t<Source>;
+
+        public:
+        struct TakeWhileIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = std::iter_value_t<SourceIterator>;
+            using pointer = void;
+            using reference = std::iter_reference_t<SourceIterator>;
+            using iterator_category = std::forward_iterator_tag;
+
+            TakeWhileIterator() = default;
+            TakeWhileIterator(TakeWhileIterable const& v, SourceIterator it) : iterable(&v), iterator(std::move(it)) {
+                Check();
+            }
+
+            reference operator*() const {
+                return *iterator;
+            }
+            TakeWhileIterator& operator++() {
+                ++iterator;
+                Check();
+                return *this;
+            }
+            TakeWhileIterator operator++(int) {
+                TakeWhileIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            bool operator==(TakeWhileIterator const& other) const {
+                return done == other.done && (done || iterator == other.iterator);
+            }
+
+            private:
+            TakeWhileIterable const* iterable = nullptr;
+            SourceIterator iterator = {};
+            bool done = true;
+
+            void Check() {
+                done = iterator == iterable->source->end() || !(*iterable->function)(*iterator);
+            }
+        };
+
+        using iterator = TakeWhileIterator;
+        using value_type = std::iter_value_t<SourceIterator>;
+
+        template<class T>
+        explicit TakeWhileIterable(T&& source, F&& func) : source(std::forward<T>(source)), function(std::forward<F>(func)) {}
+
+        iterator begin() const {
+            return TakeWhileIterator(*this, source->begin());
+        }
+
+        iterator end() const {
+            return TakeWhileIterator();
+        }
+
+        /// At most as many elements as the source
+        SizeHint size_hint() const {
+            return { GetSizeHint(*source).count, false };
+        }
+
+        private:
+        detail::Stored<Source> source;
+        detail::Stored<F> function;
+    };
+
+    /// Result of SkipWhile. begin() walks past the leading elements that satisfy the predicate, the iterators are the source's own
+    template<class Source, class F>
+    class SkipWhileIterable {
+        using SourceIterator = detail::source_iterator_t<Source>;
+
+        public:
+        using iterator = SourceIterator;
+        using value_type = std::iter_value_t<SourceIterator>;
+
+        template<class T>
+        explicit SkipWhileIterable(T&& source, F&& func) : source(std::forward<T>(source)), function(std::forward<F>(func)) {}
+
+        iterator begin() const {
+            auto it = source->begin();
+            auto last = source->end();
+            while (it != last && (*function)(*it)) ++it;
+            return it;
+        }
+
+        iterator end() const {
+            return source->end();
+        }
+
+        /// At most as many elements as the source
+        SizeHint size_hint() const {
+            return { GetSizeHint(*source).count, false };
+        }
+
+        private:
+        detail::Stored<Source> source;
+        detail::Stored<F> function;
+    };
+
+    namespace detail {
+        // A span when the iterators are contiguous, so Chunk and Window over an array hand out plain memory
+        template<class I>
+        auto MakeView(I first, I last) {
+            if constexpr (std::contiguous_iterator<I>) {
+                return std::span<std::remove_reference_t<std::iter_reference_t<I>>>(std::to_address(first), static_cast<size_t>(last - first));
+            } else {
+                return IteratorRange<I>{ std::move(first), std::move(last) };
+            }
+        }
+
+        template<class I>
+        using view_t = decltype(MakeView(std::declval<I>(), std::declval<I>()));
+    }
+
+    /**
+     * Result of Chunk. Yields consecutive pieces of size elements, the last one shorter if the size doesn't divide evenly.
+     * Pieces are std::span for contiguous sources and IteratorRange otherwise, both pointing into the source without copying
+     */
+    template<class Source>
+    class ChunkIterable {
+        using SourceIterator = detail::source_iterator_t<Source>;
+
+        public:
+        using value_type = detail::view_t<SourceIterator>;
+
+        struct ChunkIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = ChunkIterable::value_type;
+            using pointer = void;
+            using reference = value_type;
+            using iterator_category = std::forward_iterator_tag;
+
+            ChunkIterator() = default;
+            ChunkIterator(ChunkIterable const& v, SourceIterator it) : iterable(&v), first(it), next(detail::AdvanceBounded(it, v.size, v.source->end())) {}
+
+            reference operator*() const {
+                return detail::MakeView(first, next);
+            }
+            ChunkIterator& operator++() {
+                first = next;
+                next = detail::AdvanceBounded(next, iterable->size, iterable->source->end());
+                return *this;
+            }
+            ChunkIterator operator++(int) {
+                ChunkIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            bool operator==(ChunkIterator const& other) const {
+                return first == other.first;
+            }
+
+            private:
+            ChunkIterable const* iterable = nullptr;
+            SourceIterator first = {};
+            SourceIterator next = {};
+        };
+
+        using iterator = ChunkIterator;
+
+        template<class T>
+        explicit ChunkIterable(T&& source, size_t size) : source(std::forward<T>(source)), size(std::max<size_t>(size, 1)) {}
+
+        iterator begin() const {
+            return ChunkIterator(*this, source->begin());
+        }
+
+        iterator end() const {
+            return ChunkIterator(*this, source->end());
+        }
+
+        SizeHint size_hint() const {
+            SizeHint hint = GetSizeHint(*source);
+            if (hint.count == SIZE_MAX) return hint;
+            return { (hint.count + size - 1) / size, hint.exact };
+        }
+
+        private:
+        detail::Stored<Source> source;
+        size_t size;
+    };
+
+    /**
+     * Result of Window. Yields every run of size neighbouring elements, the first starting at the first element
+     * and each next one a step further, nothing when the source is shorter than size.
+     * Windows are std::span for contiguous sources and IteratorRange otherwise, both pointing into the source without copying
+     */
+    template<class Source>
+    class WindowIterable {
+        using SourceIterator = detail::source_iterator_t<Source>;
+
+        public:
+        using value_type = detail::view_t<SourceIterator>;
+
+        struct WindowIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = WindowIterable::value_type;
+            using pointer = void;
+            using reference = value_type;
+            using iterator_category = std::forward_iterator_tag;
+
+            WindowIterator() = default;
+            WindowIterator(WindowIterable const& v, SourceIterator it) : iterable(&v), first(it), back(detail::AdvanceBounded(it, v.size, v.source->end())) {
+                // too few elements for a whole window. Only checked here, after this back moves one step at a time
+                done = static_cast<size_t>(std::distance(first, back)) < iterable->size;
+            }
+
+            reference operator*() const {
+                return detail::MakeView(first, back);
+            }
+            WindowIterator& operator++() {
+                if (back == iterable->source->end()) {
+                    done = true;
+                } else {
+                    ++first;
+                    ++back;
+                }
+                return *this;
+            }
+            WindowIterator operator++(int) {
+                WindowIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            bool operator==(WindowIterator const& other) const {
+                return done == other.done && (done || first == other.first);
+            }
+
+            private:
+            WindowIterable const* iterable = nullptr;
+            SourceIterator first = {};
+            SourceIterator back = {};
+            bool done = true;
+        };
+
+        using iterator = WindowIterator;
+
+        template<class T>
+        explicit WindowIterable(T&& source, size_t size) : source(std::forward<T>(source)), size(std::max<size_t>(size, 1)) {}
+
+        iterator begin() const {
+            return WindowIterator(*this, source->begin());
+        }
+
+        iterator end() const {
+            return WindowIterator();
+        }
+
+        SizeHint size_hint() const {
+            SizeHint hint = GetSizeHint(*source);
+            if (hint.count == SIZE_MAX) return hint;
+            return { hint.count >= size ? hint.count - size + 1 : 0, hint.exact };
+        }
+
+        private:
+        detail::Stored<Source> source;
+        size_t size;
+    };
+    /**
+     * Result of Zip. Walks several sources side by side and yields a std::tuple of what each iterator gives, references into
+     * the sources for containers, stopping with the shortest one. When every source is random access so is this, with O(1) size.
+     * Holds its sources as noted at the top of this file
+     */
+    template<class... Sources>
+    class ZipIterable {
+        constexpr static bool RandomAccess = (std::random_access_iterator<detail::source_iterator_t<Sources>> && ...);
+        using Iterators = std::tuple<detail::source_iterator_t<Sources>...>;
+
+        public:
+        using value_type = std::tuple<std::iter_value_t<detail::source_iterator_t<Sources>>...>;
+
+        struct ZipIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = ZipIterable::value_type;
+            using pointer = void;
+            using reference = std::tuple<std::iter_reference_t<detail::source_iterator_t<Sources>>...>;
+            // ends of different length sources only line up for random access, where end() is cut to the shortest
+            using iterator_category = std::conditional_t<RandomAccess, std::random_access_iterator_tag, std::forward_iterator_tag>;
+
+            ZipIterator() = default;
+            explicit ZipIterator(Iterators iterators) : iterators(std::move(iterators)) {}
+
+            reference operator*() const {
+                return std::apply([](auto const&... it) { return reference(*it...); }, iterators);
+            }
+            ZipIterator& operator++() {
+                std::apply([](auto&... it) { (++it, ...); }, iterators);
+                return *this;
+            }
+            ZipIterator operator++(int) {
+                ZipIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            ZipIterator& operator--() requires (RandomAccess) {
+                std::apply([](auto&... it) { (--it, ...); }, iterators);
+                return *this;
+            }
+            ZipIterator operator--(int) requires (RandomAccess) {
+                ZipIterator ret = *this;
+                --*this;
+                return ret;
+            }
+            ZipIterator& operator+=(difference_type n) requires (RandomAccess) {
+                std::apply([n](auto&... it) { ((it += n), ...); }, iterators);
+                return *this;
+            }
+            ZipIterator& operator-=(difference_type n) requires (RandomAccess) {
+                return *this += -n;
+            }
+            ZipIterator operator+(difference_type n) const requires (RandomAccess) {
+                ZipIterator ret = *this;
+                return ret += n;
+            }
+            friend ZipIterator operator+(difference_type n, ZipIterator const& it) requires (RandomAccess) {
+                return it + n;
+            }
+            ZipIterator operator-(difference_type n) const requires (RandomAccess) {
+                ZipIterator ret = *this;
+                return ret -= n;
+            }
+            difference_type operator-(ZipIterator const& other) const requires (RandomAccess) {
+                return std::get<0>(iterators) - std::get<0>(other.iterators);
+            }
+            reference operator[](difference_type n) const requires (RandomAccess) {
+                return *(*this + n);
+            }
+            // any source at its end ends the zip, so one matching iterator is enough
+            bool operator==(ZipIterator const& other) const {
+                if constexpr (RandomAccess) {
+                    return std::get<0>(iterators) == std::get<0>(other.iterators);
+                } else {
+                    return AnyEqual(other, std::index_sequence_for<Sources...>());
+                }
+            }
+            bool operator<(ZipIterator const& other) const requires (RandomAccess) {
+                return std::get<0>(iterators) < std::get<0>(other.iterators);
+            }
+            bool operator>(ZipIterator const& other) const requires (RandomAccess) {
+                return other < *this;
+            }
+            bool operator<=(ZipIterator const& other) const requires (RandomAccess) {
+                return !(other < *this);
+            }
+            bool operator>=(ZipIterator const& other) const requires (RandomAccess) {
+                return !(*this < other);
+            }
+
+            private:
+            Iterators iterators = {};
+
+            template<size_t... Is>
+            bool AnyEqual(ZipIterator const& other, std::index_sequence<Is...>) const {
+                return ((std::get<Is>(iterators) == std::get<Is>(other.iterators)) || ...);
+            }
+        };
+
+        using iterator = ZipIterator;
+
+        template<class... T>
+        requires (sizeof...(T) == sizeof...(Sources) && sizeof...(T) != 0 && !std::is_same_v<std::remove_cvref_t<std::tuple_element_t<0, std::tuple<T...>>>, ZipIterable>)
+        explicit ZipIterable(T&&... sources) : sources(std::forward<T>(sources)...) {}
+
+        iterator begin() const {
+            return ZipIterator(std::apply([](auto&... source) { return Iterators(source->begin()...); }, sources));
+        }
+
+        iterator end() const {
+            if constexpr (RandomAccess) {
+                return begin() + static_cast<std::ptrdiff_t>(size());
+            } else {
+                return ZipIterator(std::apply([](auto&... source) { return Iterators(source->end()...); }, sources));
+            }
+        }
+
+        /// Length of the shortest source
+        size_t size() const requires (RandomAccess) {
+            return std::apply([](auto&... source) { return std::min({ static_cast<size_t>(source->end() - source->begin())... }); }, sources);
+        }
+
+        decltype(auto) operator[](size_t index) const requires (RandomAccess) {
+            return begin()[static_cast<std::ptrdiff_t>(index)];
+        }
+
+        SizeHint size_hint() const {
+            return std::apply([](auto&... source) {
+                SizeHint hint = { SIZE_MAX, true };
+                ((hint = Shortest(hint, GetSizeHint(*source))), ...);
+                return hint;
+            }, sources);
+        }
+
+        private:
+        std::tuple<detail::Stored<Sources>...> sources;
+
+        static SizeHint Shortest(SizeHint a, SizeHint b) {
+            return { std::min(a.count, b.count), a.exact && b.exact };
+        }
+    };
+
+    /**
+     * Result of Concat. All of first, then all of second. Two random access sources give a random access result with O(1) size.
+     * Holds its sources as noted at the top of this file
+     */
+    template<class First, class Second>
+    class ConcatIterable {
+        using FirstIterator = detail::source_iterator_t<First>;
+        using SecondIterator = detail::source_iterator_t<Second>;
+        constexpr static bool RandomAccess = std::random_access_iterator<FirstIterator> && std::random_access_iterator<SecondIterator>;
+
+        public:
+        using reference = std::common_reference_t<std::iter_reference_t<FirstIterator>, std::iter_reference_t<SecondIterator>>;
+        using value_type = std::remove_cvref_t<reference>;
+
+        struct ConcatIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = ConcatIterable::value_type;
+            using pointer = void;
+            using reference = ConcatIterable::reference;
+            using iterator_category = std::forward_iterator_tag;
+
+            ConcatIterator() = default;
+            ConcatIterator(ConcatIterable const& v, FirstIterator first, SecondIterator second) : iterable(&v), first(first), second(second) {}
+
+            reference operator*() const {
+                if (first != iterable->first->end()) return *first;
+                return *second;
+            }
+            ConcatIterator& operator++() {
+                if (first != iterable->first->end()) ++first;
+                else ++second;
+                return *this;
+            }
+            ConcatIterator operator++(int) {
+                ConcatIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            bool operator==(ConcatIterator const& other) const {
+                return first == other.first && second == other.second;
+            }
+
+            private:
+            ConcatIterable const* iterable = nullptr;
+            FirstIterator first = {};
+            SecondIterator second = {};
+        };
+
+        // Position as one index over both sources
+        struct IndexedIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = ConcatIterable::value_type;
+            using pointer = void;
+            using reference = ConcatIterable::reference;
+            using iterator_category = std::random_access_iterator_tag;
+
+            IndexedIterator() = default;
+            IndexedIterator(FirstIterator first, difference_type firstSize, SecondIterator second, difference_type index)
+                : first(first), firstSize(firstSize), second(second), index(index) {}
+
+            reference operator*() const {
+                if (index < firstSize) return first[index];
+                return second[index - firstSize];
+            }
+            IndexedIterator& operator++() {
+                ++index;
+                return *this;
+            }
+            IndexedIterator operator++(int) {
+                IndexedIterator ret = *this;
+                ++index;
+                return ret;
+            }
+            IndexedIterator& operator--() {
+                --index;
+                return *this;
+            }
+            IndexedIterator operator--(int) {
+                IndexedIterator ret = *this;
+                --index;
+                return ret;
+            }
+            IndexedIterator& operator+=(difference_type n) {
+                index += n;
+                return *this;
+            }
+            IndexedIterator& operator-=(difference_type n) {
+                index -= n;
+                return *this;
+            }
+            IndexedIterator operator+(difference_type n) const {
+                return IndexedIterator(first, firstSize, second, index + n);
+            }
+            friend IndexedIterator operator+(difference_type n, IndexedIterator const& it) {
+                return it + n;
+            }
+            IndexedIterator operator-(difference_type n) const {
+                return IndexedIterator(first, firstSize, second, index - n);
+            }
+            difference_type operator-(IndexedIterator const& other) const {
+                return index - other.index;
+            }
+            reference operator[](difference_type n) const {
+                return *(*this + n);
+            }
+            bool operator==(IndexedIterator const& other) const {
+                return index == other.index;
+            }
+            bool operator<(IndexedIterator const& other) const {
+                return index < other.index;
+            }
+            bool operator>(IndexedIterator const& other) const {
+                return index > other.index;
+            }
+            bool operator<=(IndexedIterator const& other) const {
+                return index <= other.index;
+            }
+            bool operator>=(IndexedIterator const& other) const {
+                return index >= other.index;
+            }
+
+            private:
+            FirstIterator first = {};
+            difference_type firstSize = 0;
+            SecondIterator second = {};
+            difference_type index = 0;
+        };
+
+        using iterator = std::conditional_t<RandomAccess, IndexedIterator, ConcatIterator>;
+
+        template<class A, class B>
+        explicit ConcatIterable(A&& first, B&& second) : first(std::forward<A>(first)), second(std::forward<B>(second)) {}
+
+        iterator begin() const {
+            if constexpr (RandomAccess) return IndexedIterator(first->begin(), first->end() - first->begin(), second->begin(), 0);
+            else return ConcatIterator(*this, first->begin(), second->begin());
+        }
+
+        iterator end() const {
+            if constexpr (RandomAccess) return begin() + static_cast<std::ptrdiff_t>(size());
+            else return ConcatIterator(*this, first->end(), second->end());
+        }
+
+        size_t size() const requires (RandomAccess) {
+            return (first->end() - first->begin()) + (second->end() - second->begin());
+        }
+
+        decltype(auto) operator[](size_t index) const requires (RandomAccess) {
+            return begin()[static_cast<std::ptrdiff_t>(index)];
+        }
+
+        SizeHint size_hint() const {
+            SizeHint a = GetSizeHint(*first);
+            SizeHint b = GetSizeHint(*second);
+            if (a.count == SIZE_MAX || b.count == SIZE_MAX) return { SIZE_MAX, false };
+            return { a.count + b.count, a.exact && b.exact };
+        }
+
+        private:
+        detail::Stored<First> first;
+        detail::Stored<Second> second;
+    };
+
+    /**
+     * Result of SelectMany. Yields every element of every range the function returns, one source element at a time.
+     * A range returned by reference is walked in place. One returned by value is kept in the iterator until it is used up,
+     * so copying an iterator copies it too, which the usual loops never do
+     */
+    template<class Source, class F>
+    class SelectManyIterable {
+        using OuterIterator = detail::source_iterator_t<Source>;
+        using Inner = decltype(std::declval<F const&>()(*std::declval<OuterIterator&>()));
+        constexpr static bool Holds = !std::is_lvalue_reference_v<Inner>;
+        using InnerRange = std::remove_reference_t<Inner>;
+        using InnerIterator = decltype(std::declval<InnerRange&>().begin());
+        struct NoInner {};
+
+        public:
+        using value_type = std::iter_value_t<InnerIterator>;
+
+        struct SelectManyIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = SelectManyIterable::value_type;
+            using pointer = void;
+            using reference = std::iter_reference_t<InnerIterator>;
+            using iterator_category = std::forward_iterator_tag;
+
+            SelectManyIterator() = default;
+            SelectManyIterator(SelectManyIterable const& v, OuterIterator it) : iterable(&v), outer(std::move(it)) {
+                Settle();
+            }
+            SelectManyIterator(SelectManyIterator const&) requires (!Holds) = default;
+            SelectManyIterator& operator=(SelectManyIterator const&) requires (!Holds) = default;
+            // the copied range has its own storage, so find the same position in it
+            SelectManyIterator(SelectManyIterator const& other) requires (Holds)
+                : iterable(other.iterable), outer(other.outer), inner(other.inner), index(other.index) {
+                Rebind();
+            }
+            SelectManyIterator& operator=(SelectManyIterator const& other) requires (Holds) {
+                iterable = other.iterable;
+                outer = other.outer;
+                inner = other.inner;
+                index = other.index;
+                Rebind();
+                return *this;
+            }
+
+            reference operator*() const {
+                return *current;
+            }
+            SelectManyIterator& operator++() {
+                ++index;
+                if (++current == innerEnd) {
+                    ++outer;
+                    Settle();
+                }
+                return *this;
+            }
+            SelectManyIterator operator++(int) {
+                SelectManyIterator ret = *this;
+                ++*this;
+                return ret;
+            }
+            bool operator==(SelectManyIterator const& other) const {
+                return outer == other.outer && index == other.index;
+            }
+
+            private:
+            SelectManyIterable const* iterable = nullptr;
+            OuterIterator outer = {};
+            [[no_unique_address]] std::conditional_t<Holds, std::optional<InnerRange>, NoInner> inner;
+            InnerIterator current = {};
+            InnerIterator innerEnd = {};
+            // position in the current inner range
+            size_t index = 0;
+
+            // Opens the range at outer, moving on past empty ones. At the end of the source index is 0, like end() has
+            void Settle() {
+                index = 0;
+                for (auto last = iterable->source->end(); outer != last; ++outer) {
+                    if constexpr (Holds) {
+                        auto& range = inner.emplace((*iterable->function)(*outer));
+                        current = range.begin();
+                        innerEnd = range.end();
+                    } else {
+                        auto& range = (*iterable->function)(*outer);
+                        current = range.begin();
+                        innerEnd = range.end();
+                    }
+                    if (current != innerEnd) return;
+                }
+                if constexpr (Holds) inner.reset();
+            }
+
+            void Rebind() {
+                if (inner) {
+                    current = std::next(inner->begin(), static_cast<std::ptrdiff_t>(index));
+                    innerEnd = inner->end();
+                }
+            }
+        };
+
+        using iterator = SelectManyIterator;
+
+        template<class T>
+        explicit SelectManyIterable(T&& source, F&& func) : source(std::forward<T>(source)), function(std::forward<F>(func)) {}
+
+        iterator begin() const {
+            return SelectManyIterator(*this, source->begin());
+        }
+
+        iterator end() const {
+            return SelectManyIterator(*this, source->end());
+        }
+
+        private:
+        detail::Stored<Source> source;
+        detail::Stored<F> function;
+    };
+
+    template<typename T, typename Iterator = typename T::iterator>
+    concept ConstIterable = requires(T const& t, int length, Iterator it) {
+        {T() -> SomberoConvertible<T>};
+        {T(length) -> SomberoConvertible<T>};
+        {T(it, it) -> SomberoConvertible<T>};
+        {t.begin()};
+        {t.end()};
+        {t.size()};
+    } && std::is_copy_constructible_v<T> && std::is_copy_assignable_v<T>;
+
+    template<typename T>
+    concept Iterable = ConstIterable<T> && requires(T& t) {
+        {t.begin()};
+        {t.end()};
+    } && std::is_move_constructible_v<T> && std::is_move_assignable_v<T>;
+
+
+    /**
+     * Finds all elements that satisfy @param fn
+     * @tparam T
+     * @tparam F
+     * @param list
+     * @param fn
+     * @return
+     */
+    template<class T, typename F>
+    requires (range<T>)
+    auto Where(T const& list, F&& fn) {
+        return WhereIterable(list, fn);
+    }
+
+    template<class T, typename F>
+    requires (range<T>)
+    auto Select(T const& list, F&& fn) {
+        return SelectIterable(list, fn);
+    }
+
+    /**
+     * Select whose iterators keep their current value, so reading an element twice, like a Where after it does, projects it once.
+     * Iterating again still projects again, see Memoize for that
+     */
+    template<class T, typename F>
+    requires (range<T>)
+    auto SelectCached(T const& list, F&& fn) {
+        return SelectIterable<decltype(list.begin()), F, decltype(fn(*list.begin())), true>(list, std::forward<F>(fn));
+    }
+
+    /**
+     * Lazily caches the elements of @param range the first time they are iterated, see MemoizedIterable.
+     * Put it after an expensive Select (string building, il2cpp calls) that is iterated more than once.
+     */
+    template<class T>
+    requires (range<T>)
+    auto Memoize(T&& range) {
+        return MemoizedIterable<T>(std::forward<T>(range));
+    }
+
+    /**
+     * Lazily iterates @param list from the back, see ReverseIterable. Needs bidirectional iterators, like arrays, vectors
+     * and Selects over them have.
+     */
+    template<class T>
+    requires (range<T> && std::bidirectional_iterator<decltype(std::declval<T const&>().begin())>)
+    auto Reverse(T&& list) {
+        return ReverseIterable<T>(std::forward<T>(list));
+    }
+
+    /**
+     * First @param count elements of @param list, see TakeIterable. Nothing after them is read.
+     */
+    template<class T>
+    requires (range<T>)
+    auto Take(T&& list, size_t count) {
+        return TakeIterable<T>(std::forward<T>(list), count);
+    }
+
+    /// Everything after the first @param count elements, see SkipIterable
+    template<class T>
+    requires (range<T>)
+    auto Skip(T&& list, size_t count) {
+        return SkipIterable<T>(std::forward<T>(list), count);
+    }
+
+    /// Leading elements that satisfy @param fn, up to the first one that doesn't
+    template<class T, typename F>
+    requires (range<T>)
+    auto TakeWhile(T&& list, F&& fn) {
+        return TakeWhileIterable<T, F>(std::forward<T>(list), std::forward<F>(fn));
+    }
+
+    /// Everything from the first element that doesn't satisfy @param fn on
+    template<class T, typename F>
+    requires (range<T>)
+    auto SkipWhile(T&& list, F&& fn) {
+        return SkipWhileIterable<T, F>(std::forward<T>(list), std::forward<F>(fn));
+    }
+
+    /// Consecutive pieces of @param size elements, see ChunkIterable
+    template<class T>
+    requires (range<T>)
+    auto Chunk(T&& list, size_t size) {
+        return ChunkIterable<T>(std::forward<T>(list), size);
+    }
+
+    /// Every run of @param size neighbouring elements, see WindowIterable
+    template<class T>
+    requires (range<T>)
+    auto Window(T&& list, size_t size) {
+        return WindowIterable<T>(std::forward<T>(list), size);
+    }
+
+    /// Tuples of the elements at the same position in each of @param lists, see ZipIterable
+    template<class... T>
+    requires (sizeof...(T) != 0 && (range<T> && ...))
+    auto Zip(T&&... lists) {
+        return ZipIterable<T...>(std::forward<T>(lists)...);
+    }
+
+    /// Elements of @param first followed by those of @param second, see ConcatIterable
+    template<class A, class B>
+    requires (range<A> && range<B>)
+    auto Concat(A&& first, B&& second) {
+        return ConcatIterable<A, B>(std::forward<A>(first), std::forward<B>(second));
+    }
+
+    /// Elements of every range @param fn returns for the elements of @param list, see SelectManyIterable
+    template<class T, typename F>
+    requires (range<T>)
+    auto SelectMany(T&& list, F&& fn) {
+        return SelectManyIterable<T, F>(std::forward<T>(list), std::forward<F>(fn));
+    }
+
+    namespace detail {
+        // Copies range into out, which has room for all of it. Contiguous trivially copyable items go in one memcpy
+        template<class T, class Out>
+        void CopyInto(T&& range, Out* out) {
+            using ItemT = std::remove_cvref_t<decltype(*range.begin())>;
+            if constexpr (std::contiguous_iterator<decltype(range.begin())> && std::is_trivially_copyable_v<ItemT> && std::is_same_v<ItemT, std::remove_cv_t<Out>>) {
+                size_t count = range.end() - range.begin();
+                if (count != 0) std::memcpy(out, std::to_address(range.begin()), count * sizeof(ItemT));
+            } else {
+                std::copy(range.begin(), range.end(), out);
+            }
+        }
+
+        inline std::pmr::memory_resource* OrHeap(std::pmr::memory_resource* resource) {
+            return resource ? resource : std::pmr::new_delete_resource();
+        }
+
+        // Collects a range whose exact size isn't known into a buffer from resource,
+        // reserving the upper bound if there is one so it never regrows
+        template<class T>
+        auto CollectBounded(T&& range, SizeHint hint, std::pmr::memory_resource* resource) {
+            std::pmr::vector<std::remove_cvref_t<decltype(*range.begin())>> vec(OrHeap(resource));
+            if (hint.count != SIZE_MAX) vec.reserve(hint.count);
+            for (auto&& item : range) vec.push_back(item);
+            return vec;
+        }
+
+        // Appends range to vec. Only an exact size is reserved, an upper bound could leave a lot of unused capacity behind
+        template<class Vector, class T>
+        void AppendAll(Vector& vec, T&& range) {
+            if constexpr (can_get_size<T>) {
+                vec.insert(vec.end(), range.begin(), range.end());
+            } else {
+                // the iterator pair insert would walk a forward range twice, running a Where's predicate twice
+                SizeHint hint = GetSizeHint(range);
+                if (hint.exact) vec.reserve(vec.size() + hint.count);
+                for (auto&& item : range) vec.push_back(item);
+            }
+        }
+    }
+
+    /**
+     * Copies the range into a new ArrayW. Sized sources and sources with an exact size hint, like Select over an array,
+     * are written straight into the array, otherwise the items are buffered once first.
+     * @param resource where that buffer comes from, for example a FrameArena. nullptr uses the heap
+     */
+    template<class T>
+    requires (range<T>)
+    auto ToArray(T&& range, std::pmr::memory_resource* resource = nullptr) {
+        using ItemT = std::remove_cvref_t<decltype(*range.begin())>;
+        SizeHint hint = GetSizeHint(range);
+        if (hint.exact) {
+            ArrayW<ItemT> arr(hint.count);
+            detail::CopyInto(range, arr.begin());
+            return arr;
+        }
+        auto vec = detail::CollectBounded(range, hint, resource);
+        ArrayW<ItemT> arr(vec.size());
+        detail::CopyInto(vec, arr.begin());
+        return arr;
+    }
+
+    /**
+     * Number of elements. Uses the size or an exact size hint when there is one, otherwise walks the range without storing anything
+     */
+    template<class T>
+    requires (range<T>)
+    auto Count(T&& range) {
+        if constexpr (can_get_size<T>) {
+            return get_size<T>(std::forward<T>(range));
+        } else {
+            SizeHint hint = GetSizeHint(range);
+            if (hint.exact) return hint.count;
+            size_t count = 0;
+            for (auto it = range.begin(); it != range.end(); ++it) count++;
+            return count;
+        }
+    }
+
+    /**
+     * Copies the range into a std::vector. Only an exact size is reserved, an upper bound could leave a lot of unused capacity behind
+     */
+    template<class T>
+    requires (range<T>)
+    auto ToVector(T&& range) {
+        std::vector<std::remove_cvref_t<decltype(*range.begin())>> vec;
+        detail::AppendAll(vec, range);
+        return vec;
+    }
+
+    /**
+     * Copies the range into a std::pmr::vector using @param resource. With a FrameArena that is reset every frame,
+     * per frame queries stop allocating from the heap once the arena has grown to fit a frame
+     */
+    template<class T>
+    requires (range<T>)
+    auto ToVector(T&& range, std::pmr::memory_resource* resource) {
+        std::pmr::vector<std::remove_cvref_t<decltype(*range.begin())>> vec(detail::OrHeap(resource));
+        detail::AppendAll(vec, range);
+        return vec;
+    }
+
+    /// @param resource where the buffer for sources of unknown size comes from. nullptr uses the heap
+    template<class T>
+    requires (range<T>)
+    auto ToList(T&& range, std::pmr::memory_resource* resource = nullptr) {
+        using ItemT = std::remove_cvref_t<decltype(*range.begin())>;
+        SizeHint hint = GetSizeHint(range);
+        if (hint.exact) {
+            auto lst = il2cpp_utils::NewSpecific<List<ItemT>*>(hint.count);
+            // Now that we have a list that is big enough, lets copy to it
+            #ifdef HAS_CODEGEN
+            detail::CopyInto(range, lst->items.begin());
+            #else
+            detail::CopyInto(range, &lst->items->values[0]);
+            #endif
+            return lst;
+        }
+        // We can't get the size, so we have to copy into some buffer and then copy to the list
+        auto vec = detail::CollectBounded(range, hint, resource);
+        auto lst = il2cpp_utils::NewSpecific<List<ItemT>*>(vec.size());
+        #ifdef HAS_CODEGEN
+        detail::CopyInto(vec, lst->items.begin());
+        #else
+        detail::CopyInto(vec, &lst->items->values[0]);
+        #endif
+        return lst;
+    }
+
+    template<range T, typename F>
+    auto First(T const& list, F&& fn) {
+        using ItemT = std::remove_reference_t<decltype(*list.begin())>;
+
+        for (auto v : list)
+            if (fn(v)) return std::make_optional<ItemT>(v);
+
+        return (std::optional<ItemT>) std::nullopt;
+    }
+
+    template<range T, typename F>
+    auto First(T&& list, F&& fn) {
+        using ItemT = std::remove_reference_t<decltype(*list.begin())>;
+
+        for (auto const& v : list)
+            if (fn(v)) return std::make_optional<ItemT>(v);
+
+        return (std::optional<ItemT>) std::nullopt;
+    }
+
+    template<typename... TArgs>
+    auto FirstOrDefault(TArgs&&... args) {
+        auto opt = First(std::forward<TArgs>(args)...);
+
+        return opt.template value_or<typename decltype(opt)::value_type>({});
+    }
+
+    /**
+     * Last element that satisfies @param fn. Bidirectional ranges are searched from the back and stop at the first match,
+     * others are walked to the end
+     */
+    template<range T, typename F>
+    auto Last(T&& list, F&& fn) {
+        if constexpr (std::bidirectional_iterator<decltype(list.begin())>) {
+            return First(Reverse(list), fn);
+        } else {
+            std::optional<std::remove_cvref_t<decltype(*list.begin())>> last;
+            for (auto&& v : list)
+                if (fn(v)) last = v;
+            return last;
+        }
+    }
+
+    /// Last element, nullopt if empty. O(1) for bidirectional ranges, so a Select over an array only projects that one element
+    template<range T>
+    auto Last(T&& list) {
+        using ItemT = std::remove_cvref_t<decltype(*list.begin())>;
+        auto begin = list.begin();
+        auto end = list.end();
+        if constexpr (std::bidirectional_iterator<decltype(begin)>) {
+            if (begin == end) return std::optional<ItemT>();
+            return std::make_optional<ItemT>(*--end);
+        } else {
+            std::optional<ItemT> last;
+            for (; begin != end; ++begin) last = *begin;
+            return last;
+        }
+    }
+
+    template<typename... TArgs>
+    auto LastOrDefault(TArgs&&... args) {
+        auto opt = Last(std::forward<TArgs>(args)...);
+
+        return opt.template value_or<typename decltype(opt)::value_type>({});
+    }
+
+    /// Element at @param index, nullopt if the range is shorter. O(1) for random access ranges, which includes Selects over them
+    template<range T>
+    auto ElementAt(T&& list, size_t index) {
+        using ItemT = std::remove_cvref_t<decltype(*list.begin())>;
+        auto it = list.begin();
+        auto end = list.end();
+        if constexpr (std::random_access_iterator<decltype(it)>) {
+            if (index >= static_cast<size_t>(end - it)) return std::optional<ItemT>();
+            return std::make_optional<ItemT>(it[static_cast<std::ptrdiff_t>(index)]);
+        } else {
+            for (; index != 0 && it != end; index--) ++it;
+            if (it == end) return std::optional<ItemT>();
+            return std::make_optional<ItemT>(*it);
+        }
+    }
+
+    template<typename... TArgs>
+    auto ElementAtOrDefault(TArgs&&... args) {
+        auto opt = ElementAt(std::forward<TArgs>(args)...);
+
+        return opt.template value_or<typename decltype(opt)::value_type>({});
+    }
+
+    template<ConstIterable T, typename F>
+    bool Any(T const& list, F&& fn) {
+        for (auto it = list.begin(); it != list.end(); it++) {
+            if (fn(*it)) return true;
+        }
+
+        return false;
+    }
+
+    template<ConstIterable T, typename F>
+    bool All(T const& list, F&& fn) {
+        for (auto it = list.begin(); it != list.end(); it++) {
+            if (!fn(*it)) return false;
+        }
+
+        return true;
+    }
+
+    namespace detail {
+        template<class R>
+        using range_value_t = std::remove_cvref_t<decltype(*std::declval<R&>().begin())>;
+
+        template<class T>
+        concept float_vector = is_float_vector<std::remove_cv_t<T>> && std::is_trivially_copyable_v<T> && sizeof(T) % sizeof(float) == 0;
+
+        template<class R>
+        concept contiguous_range = range<R> && std::contiguous_iterator<decltype(std::declval<R&>().begin())>;
+
+        // What Sum accumulates in. Small integers promote like they do for +
+        template<class T>
+        using sum_t = std::conditional_t<float_vector<T>, T, std::remove_cvref_t<decltype(std::declval<T>() + std::declval<T>())>>;
+
+        // What Average accumulates in. Integers use 64 bits so large inputs don't overflow
+        template<class T>
+        using average_accumulator_t = std::conditional_t<std::is_integral_v<T>, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>, sum_t<T>>;
+
+        template<class T>
+        using average_t = std::conditional_t<std::is_integral_v<T>, double, sum_t<T>>;
+
+        // Sums count projected values with independent accumulators, so the adds don't wait on each other
+        // and the compiler turns each group of lanes into vector adds without needing -ffast-math
+        template<class S, class V, class F>
+        S SumContiguous(V const* data, size_t count, F&& selector) {
+            if constexpr (float_vector<S>) {
+                constexpr size_t Components = sizeof(S) / sizeof(float);
+                constexpr size_t Lanes = 8;
+                float acc[Lanes][Components] = {};
+                float total[Components] = {};
+                size_t blocks = count - count % Lanes;
+                size_t i = 0;
+                for (; i < blocks; i += Lanes) {
+                    for (size_t j = 0; j < Lanes; j++) {
+                        S value = selector(data[i + j]);
+                        float components[Components];
+                        std::memcpy(components, &value, sizeof(S));
+                        for (size_t c = 0; c < Components; c++) acc[j][c] += components[c];
+                    }
+                }
+                for (; i < count; i++) {
+                    S value = selector(data[i]);
+                    float components[Components];
+                    std::memcpy(components, &value, sizeof(S));
+                    for (size_t c = 0; c < Components; c++) total[c] += components[c];
+                }
+                for (size_t j = 0; j < Lanes; j++) {
+                    for (size_t c = 0; c < Components; c++) total[c] += acc[j][c];
+                }
+                S result;
+                std::memcpy(&result, total, sizeof(S));
+                return result;
+            } else {
+                constexpr size_t Lanes = std::max<size_t>(4, 64 / sizeof(S));
+                S acc[Lanes] = {};
+                size_t blocks = count - count % Lanes;
+                size_t i = 0;
+                for (; i < blocks; i += Lanes) {
+                    for (size_t j = 0; j < Lanes; j++) acc[j] += static_cast<S>(selector(data[i + j]));
+                }
+                S total = {};
+                for (size_t j = 0; j < Lanes; j++) total += acc[j];
+                for (; i < count; i++) total += static_cast<S>(selector(data[i]));
+                return total;
+            }
+        }
+
+        template<class S, class T, class F>
+        S SumRange(T&& range, F&& selector) {
+            if constexpr (contiguous_range<T>) {
+                return SumContiguous<S>(std::to_address(range.begin()), range.end() - range.begin(), selector);
+            } else {
+                S total = {};
+                for (auto&& item : range) total = total + static_cast<S>(selector(item));
+                return total;
+            }
+        }
+
+        // Min or max over contiguous arithmetic values, same lane idea as SumContiguous
+        template<bool Greater, class V, class F>
+        auto ExtremeContiguous(V const* data, size_t count, F&& selector) {
+            using K = std::remove_cvref_t<decltype(selector(*data))>;
+            constexpr size_t Lanes = std::max<size_t>(4, 64 / sizeof(K));
+            K best = selector(data[0]);
+            size_t i = 1;
+            if (count - 1 >= Lanes) {
+                K acc[Lanes];
+                for (size_t j = 0; j < Lanes; j++) acc[j] = best;
+                size_t blocks = count - (count - 1) % Lanes;
+                for (; i < blocks; i += Lanes) {
+                    for (size_t j = 0; j < Lanes; j++) {
+                        K value = selector(data[i + j]);
+                        if constexpr (Greater) acc[j] = acc[j] < value ? value : acc[j];
+                        else acc[j] = value < acc[j] ? value : acc[j];
+                    }
+                }
+                for (size_t j = 0; j < Lanes; j++) {
+                    if constexpr (Greater) best = best < acc[j] ? acc[j] : best;
+                    else best = acc[j] < best ? acc[j] : best;
+                }
+            }
+            for (; i < count; i++) {
+                K value = selector(data[i]);
+                if constexpr (Greater) best = best < value ? value : best;
+                else best = value < best ? value : best;
+            }
+            return best;
+        }
+
+        template<bool Greater, class T, class F>
+        auto Extreme(T&& range, F&& selector) {
+            using K = std::remove_cvref_t<decltype(selector(*range.begin()))>;
+            if constexpr (contiguous_range<T> && std::is_arithmetic_v<K>) {
+                size_t count = range.end() - range.begin();
+                if (count == 0) return std::optional<K>();
+                return std::make_optional<K>(ExtremeContiguous<Greater>(std::to_address(range.begin()), count, selector));
+            } else {
+                std::optional<K> best;
+                for (auto&& item : range) {
+                    K value = selector(item);
+                    if (!best || (Greater ? *best < value : value < *best)) best = value;
+                }
+                return best;
+            }
+        }
+
+        // Item with the smallest or largest key. Each key is computed once, ties keep the first item like C#
+        template<bool Greater, class T, class F>
+        auto ExtremeBy(T&& range, F&& keySelector) {
+            using ItemT = range_value_t<T>;
+            using K = std::remove_cvref_t<decltype(keySelector(*range.begin()))>;
+
+            auto it = range.begin();
+            auto end = range.end();
+            if (!(it != end)) return std::optional<ItemT>();
+
+            std::optional<ItemT> best(*it);
+            K bestKey = keySelector(*it);
+            for (++it; it != end; ++it) {
+                K key = keySelector(*it);
+                if (Greater ? bestKey < key : key < bestKey) {
+                    bestKey = key;
+                    best = *it;
+                }
+            }
+            return best;
+        }
+    }
+
+    /**
+     * Sum of every element, or of @param selector applied to every element.
+     * Contiguous sources of numbers or float vectors (FastVector3 etc.) use several accumulators so the loop vectorizes.
+     * Float results can differ from a left to right sum in the last bits.
+     * @return 0 for an empty range
+     */
+    template<range T, typename F = std::identity>
+    auto Sum(T&& range, F&& selector = {}) {
+        using S = detail::sum_t<std::remove_cvref_t<decltype(selector(*range.begin()))>>;
+        return detail::SumRange<S>(std::forward<T>(range), selector);
+    }
+
+    /**
+     * Average of every element, or of @param selector applied to every element.
+     * Integers are summed in 64 bits and averaged as double
+     * @return nullopt for an empty range
+     */
+    template<range T, typename F = std::identity>
+    auto Average(T&& range, F&& selector = {}) {
+        using V = std::remove_cvref_t<decltype(selector(*range.begin()))>;
+        using A = detail::average_t<V>;
+        using Acc = detail::average_accumulator_t<V>;
+
+        size_t count = 0;
+        Acc total;
+        if constexpr (detail::contiguous_range<T>) {
+            count = range.end() - range.begin();
+            total = detail::SumRange<Acc>(range, selector);
+        } else {
+            total = detail::SumRange<Acc>(range, [&count, &selector](auto&& item) {
+                count++;
+                return selector(item);
+            });
+        }
+
+        if (count == 0) return std::optional<A>();
+        if constexpr (detail::float_vector<A>) {
+            constexpr size_t Components = sizeof(A) / sizeof(float);
+            float components[Components];
+            std::memcpy(components, &total, sizeof(A));
+            for (auto& component : components) component /= static_cast<float>(count);
+            A result;
+            std::memcpy(&result, components, sizeof(A));
+            return std::make_optional<A>(result);
+        } else {
+            return std::make_optional<A>(static_cast<A>(total) / static_cast<A>(count));
+        }
+    }
+
+    /**
+     * Smallest element, or smallest value of @param selector
+     * @return nullopt for an empty range
+     */
+    template<range T, typename F = std::identity>
+    auto Min(T&& range, F&& selector = {}) {
+        return detail::Extreme<false>(std::forward<T>(range), selector);
+    }
+
+    /**
+     * Largest element, or largest value of @param selector
+     * @return nullopt for an empty range
+     */
+    template<range T, typename F = std::identity>
+    auto Max(T&& range, F&& selector = {}) {
+        return detail::Extreme<true>(std::forward<T>(range), selector);
+    }
+
+    /**
+     * Element with the smallest key from @param keySelector
+     * @return nullopt for an empty range
+     */
+    template<range T, typename F>
+    auto MinBy(T&& range, F&& keySelector) {
+        return detail::ExtremeBy<false>(std::forward<T>(range), keySelector);
+    }
+
+    /**
+     * Element with the largest key from @param keySelector
+     * @return nullopt for an empty range
+     */
+    template<range T, typename F>
+    auto MaxBy(T&& range, F&& keySelector) {
+        return detail::ExtremeBy<true>(std::forward<T>(range), keySelector);
+    }
+
+    /**
+     * Folds every element into @param seed with @param fn, left to right
+     */
+    template<range T, typename A, typename F>
+    auto Aggregate(T&& range, A seed, F&& fn) {
+        for (auto&& item : range) seed = fn(std::move(seed), item);
+        return seed;
+    }
+
+    /**
+     * Folds every element with @param fn, using the first element as the seed
+     * @return nullopt for an empty range
+     */
+    template<range T, typename F>
+    auto Aggregate(T&& range, F&& fn) {
+        using ItemT = detail::range_value_t<T>;
+
+        auto it = range.begin();
+        auto end = range.end();
+        if (!(it != end)) return std::optional<ItemT>();
+
+        ItemT result = *it;
+        for (++it; it != end; ++it) result = fn(std::move(result), *it);
+        return std::make_optional<ItemT>(std::move(result));
+    }
+
+    namespace detail {
+        // Keys that can be radix sorted, by mapping them to unsigned integers with the same order
+        template<class K>
+        concept radix_key = std::is_arithmetic_v<K> && !std::is_same_v<K, bool> && sizeof(K) <= sizeof(uint64_t);
+
+        template<radix_key K>
+        using radix_bits_t = std::conditional_t<sizeof(K) <= sizeof(uint32_t), uint32_t, uint64_t>;
+
+        template<radix_key K>
+        constexpr radix_bits_t<K> RadixBits(K key) {
+            using U = radix_bits_t<K>;
+            constexpr U SignBit = U(1) << (sizeof(U) * 8 - 1);
+            if constexpr (std::is_floating_point_v<K>) {
+                // float and double are 32 and 64 bits, so the cast is exact.
+                // Negative values flip every bit, positive ones only the sign, which orders the bits like the values
+                U bits = std::bit_cast<std::conditional_t<sizeof(K) == sizeof(uint32_t), uint32_t, uint64_t>>(key);
+                U mask = static_cast<U>(-static_cast<std::make_signed_t<U>>(bits >> (sizeof(U) * 8 - 1))) | SignBit;
+                return bits ^ mask;
+            } else if constexpr (std::is_signed_v<K>) {
+                return static_cast<U>(static_cast<std::make_signed_t<U>>(key)) ^ SignBit;
+            } else {
+                return static_cast<U>(key);
+            }
+        }
+
+        // Vector of T using Alloc rebound to T, so scratch buffers come from the same place as the result
+        template<class T, class Alloc>
+        using rebind_vector = std::vector<T, typename std::allocator_traits<Alloc>::template rebind_alloc<T>>;
+
+        // Stable LSD radix sort of (bits, index) pairs, one byte per pass.
+        // Passes where every key has the same byte are skipped, which is common for floats in a small range
+        template<class Entries>
+        void RadixSort(Entries& entries) {
+            using U = typename Entries::value_type::first_type;
+            constexpr size_t Passes = sizeof(U);
+            size_t counts[Passes][256] = {};
+            for (auto const& entry : entries) {
+                for (size_t pass = 0; pass < Passes; pass++) counts[pass][(entry.first >> (pass * 8)) & 0xFF]++;
+            }
+
+            Entries buffer(entries.size(), entries.get_allocator());
+            for (size_t pass = 0; pass < Passes; pass++) {
+                auto& count = counts[pass];
+                if (count[(entries[0].first >> (pass * 8)) & 0xFF] == entries.size()) continue;
+
+                size_t offset = 0;
+                for (auto& bucket : count) {
+                    size_t size = bucket;
+                    bucket = offset;
+                    offset += size;
+                }
+                for (auto const& entry : entries) buffer[count[(entry.first >> (pass * 8)) & 0xFF]++] = entry;
+                entries.swap(buffer);
+            }
+        }
+
+        template<class F, bool Descending>
+        struct OrderKey {
+            F selector;
+        };
+
+        template<class Key, class ItemT>
+        using order_key_t = std::remove_cvref_t<decltype(std::declval<Key&>().selector(std::declval<ItemT const&>()))>;
+
+        template<class Key>
+        struct order_key_descending;
+        template<class F, bool Descending>
+        struct order_key_descending<OrderKey<F, Descending>> : std::bool_constant<Descending> {};
+
+        template<bool Descending, class K>
+        constexpr bool KeyBefore(K const& a, K const& b) {
+            if constexpr (Descending) return b < a;
+            else return a < b;
+        }
+    }
+
+    /**
+     * Result of OrderBy. Holds a copy of the source and sorts it the first time it is enumerated,
+     * so ThenBy can add keys before any work is done. Threads enumerating the same result at once wait for one of them to sort.
+     * Every key is computed once per element and the sort is stable, like C#.
+     * A single arithmetic key is radix sorted, otherwise indices are sorted by the precomputed keys.
+     * Items is the std::vector the copy is kept in, the sort's scratch buffers use its allocator too.
+     */
+    template<class Items, class... Keys>
+    class OrderedIterable {
+        using ItemT = typename Items::value_type;
+        using Alloc = typename Items::allocator_type;
+
+        public:
+        using iterator = typename Items::const_iterator;
+
+        OrderedIterable(Items&& items, std::tuple<Keys...>&& keys) : items(std::move(items)), keys(std::move(keys)) {}
+
+        OrderedIterable(OrderedIterable const& other) : keys(other.keys) {
+            std::lock_guard lock(other.sortMutex);
+            items = other.items;
+            sorted.store(other.sorted.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        OrderedIterable(OrderedIterable&& other) : items(std::move(other.items)), keys(std::move(other.keys)), sorted(other.sorted.load(std::memory_order_relaxed)) {}
+        // by hand only for the sort lock, which isn't copied. The items and flag are read under the other's lock, like copying
+        OrderedIterable& operator=(OrderedIterable const& other) {
+            if (this != &other) {
+                std::lock_guard lock(other.sortMutex);
+                items = other.items;
+                keys = other.keys;
+                sorted.store(other.sorted.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            return *this;
+        }
+        OrderedIterable& operator=(OrderedIterable&& other) {
+            items = std::move(other.items);
+            keys = std::move(other.keys);
+            sorted.store(other.sorted.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        iterator begin() const {
+            Sort();
+            return items.cbegin();
+        }
+
+        iterator end() const {
+            Sort();
+            return items.cend();
+        }
+
+        size_t size() const {
+            return items.size();
+        }
+
+        template<bool Descending, class F>
+        auto ThenBy(F&& keySelector) const& {
+            return OrderedIterable<Items, Keys..., detail::OrderKey<std::decay_t<F>, Descending>>(
+                CopyItems(), std::tuple_cat(*keys, std::make_tuple(detail::OrderKey<std::decay_t<F>, Descending>{keySelector})));
+        }
+
+        template<bool Descending, class F>
+        auto ThenBy(F&& keySelector) && {
+            return OrderedIterable<Items, Keys..., detail::OrderKey<std::decay_t<F>, Descending>>(
+                std::move(items), std::tuple_cat(std::move(*keys), std::make_tuple(detail::OrderKey<std::decay_t<F>, Descending>{keySelector})));
+        }
+
+        private:
+        mutable Items items;
+        detail::Stored<std::tuple<Keys...>> keys;
+        // set once items is sorted, checked without the lock so later enumerations cost nothing
+        mutable std::atomic<bool> sorted = false;
+        mutable std::mutex sortMutex;
+
+        void Sort() const {
+            if (sorted.load(std::memory_order_acquire)) return;
+            std::lock_guard lock(sortMutex);
+            if (sorted.load(std::memory_order_relaxed)) return;
+            SortItems();
+            sorted.store(true, std::memory_order_release);
+        }
+
+        // Copies items, on the same allocator, while no other thread is sorting them
+        Items CopyItems() const {
+            std::lock_guard lock(sortMutex);
+            return Items(items, items.get_allocator());
+        }
+
+        void SortItems() const {
+            if (items.size() < 2) return;
+
+            detail::rebind_vector<uint32_t, Alloc> order(items.get_allocator());
+            using FirstKey = std::tuple_element_t<0, std::tuple<Keys...>>;
+            using K = detail::order_key_t<FirstKey, ItemT>;
+            if constexpr (sizeof...(Keys) == 1 && detail::radix_key<K>) {
+                constexpr bool Descending = detail::order_key_descending<FirstKey>::value;
+                using U = detail::radix_bits_t<K>;
+                detail::rebind_vector<std::pair<U, uint32_t>, Alloc> entries(items.size(), items.get_allocator());
+                for (size_t i = 0; i < items.size(); i++) {
+                    U bits = detail::RadixBits(std::get<0>(*keys).selector(items[i]));
+                    entries[i] = { Descending ? ~bits : bits, static_cast<uint32_t>(i) };
+                }
+                // below a few hundred items the histograms cost more than they save
+                if (entries.size() < 256) std::sort(entries.begin(), entries.end());
+                else detail::RadixSort(entries);
+
+                order.reserve(entries.size());
+                for (auto const& entry : entries) order.push_back(entry.second);
+            } else {
+                using KeyTuple = std::tuple<detail::order_key_t<Keys, ItemT>...>;
+                detail::rebind_vector<std::pair<KeyTuple, uint32_t>, Alloc> entries(items.get_allocator());
+                entries.reserve(items.size());
+                for (size_t i = 0; i < items.size(); i++) {
+                    auto const& item = items[i];
+                    entries.emplace_back(std::apply([&item](auto const&... key) { return KeyTuple(key.selector(item)...); }, *keys), static_cast<uint32_t>(i));
+                }
+                // ties fall back to the index, which keeps the sort stable without stable_sort
+                std::sort(entries.begin(), entries.end(), [](auto const& a, auto const& b) {
+                    return Compare<0>(a.first, b.first, a.second < b.second);
+                });
+
+                order.reserve(entries.size());
+                for (auto const& entry : entries) order.push_back(entry.second);
+            }
+
+            Items sortedItems(items.get_allocator());
+            sortedItems.reserve(items.size());
+            for (uint32_t index : order) sortedItems.push_back(std::move(items[index]));
+            items.swap(sortedItems);
+        }
+
+        template<size_t I, class KeyTuple>
+        static bool Compare(KeyTuple const& a, KeyTuple const& b, bool tie) {
+            if constexpr (I == sizeof...(Keys)) {
+                return tie;
+            } else {
+                constexpr bool Descending = detail::order_key_descending<std::tuple_element_t<I, std::tuple<Keys...>>>::value;
+                if (detail::KeyBefore<Descending>(std::get<I>(a), std::get<I>(b))) return true;
+                if (detail::KeyBefore<Descending>(std::get<I>(b), std::get<I>(a))) return false;
+                return Compare<I + 1>(a, b, tie);
+            }
+        }
+    };
+
+    template<class T>
+    concept ordered_iterable = requires (T& t) {
+        t.template ThenBy<false>([](auto const&) { return 0; });
+    };
+
+    /**
+     * Sorts by @param keySelector, smallest first. Lazy, the sort runs on first enumeration
+     */
+    template<range T, typename F>
+    auto OrderBy(T&& range, F&& keySelector) {
+        using ItemT = detail::range_value_t<T>;
+        using Key = detail::OrderKey<std::decay_t<F>, false>;
+        std::vector<ItemT> items;
+        detail::AppendAll(items, range);
+        return OrderedIterable<std::vector<ItemT>, Key>(std::move(items), std::make_tuple(Key{keySelector}));
+    }
+
+    /// OrderBy with the copy and the sort's buffers taken from @param resource
+    template<range T, typename F>
+    auto OrderBy(T&& range, F&& keySelector, std::pmr::memory_resource* resource) {
+        using ItemT = detail::range_value_t<T>;
+        using Key = detail::OrderKey<std::decay_t<F>, false>;
+        std::pmr::vector<ItemT> items(detail::OrHeap(resource));
+        detail::AppendAll(items, range);
+        return OrderedIterable<std::pmr::vector<ItemT>, Key>(std::move(items), std::make_tuple(Key{keySelector}));
+    }
+
+    /**
+     * Sorts by @param keySelector, largest first. Lazy, the sort runs on first enumeration
+     */
+    template<range T, typename F>
+    auto OrderByDescending(T&& range, F&& keySelector) {
+        using ItemT = detail::range_value_t<T>;
+        using Key = detail::OrderKey<std::decay_t<F>, true>;
+        std::vector<ItemT> items;
+        detail::AppendAll(items, range);
+        return OrderedIterable<std::vector<ItemT>, Key>(std::move(items), std::make_tuple(Key{keySelector}));
+    }
+
+    /// OrderByDescending with the copy and the sort's buffers taken from @param resource
+    template<range T, typename F>
+    auto OrderByDescending(T&& range, F&& keySelector, std::pmr::memory_resource* resource) {
+        using ItemT = detail::range_value_t<T>;
+        using Key = detail::OrderKey<std::decay_t<F>, true>;
+        std::pmr::vector<ItemT> items(detail::OrHeap(resource));
+        detail::AppendAll(items, range);
+        return OrderedIterable<std::pmr::vector<ItemT>, Key>(std::move(items), std::make_tuple(Key{keySelector}));
+    }
+
+    /**
+     * Orders items with equal keys from OrderBy by @param keySelector, smallest first
+     */
+    template<ordered_iterable T, typename F>
+    auto ThenBy(T&& ordered, F&& keySelector) {
+        return std::forward<T>(ordered).template ThenBy<false>(keySelector);
+    }
+
+    /**
+     * Orders items with equal keys from OrderBy by @param keySelector, largest first
+     */
+    template<ordered_iterable T, typename F>
+    auto ThenByDescending(T&& ordered, F&& keySelector) {
+        return std::forward<T>(ordered).template ThenBy<true>(keySelector);
+    }
+
+    namespace detail {
+        // Keeps the best count items seen so far in a heap whose top is the worst of them,
+        // so each element costs one key and usually one comparison
+        template<bool Descending, class T, class F>
+        auto TopN(T&& range, size_t count, F&& keySelector) {
+            using ItemT = range_value_t<T>;
+            using K = std::remove_cvref_t<decltype(keySelector(*range.begin()))>;
+            struct Entry {
+                K key;
+                size_t index;
+                ItemT item;
+            };
+            auto better = [](Entry const& a, Entry const& b) {
+                if (KeyBefore<Descending>(a.key, b.key)) return true;
+                if (KeyBefore<Descending>(b.key, a.key)) return false;
+                return a.index < b.index;
+            };
+
+            std::vector<Entry> heap;
+            if (count == 0) return std::vector<ItemT>();
+            if constexpr (can_get_size<T>) heap.reserve(std::min<size_t>(count, get_size(range)));
+
+            size_t index = 0;
+            for (auto&& item : range) {
+                K key = keySelector(item);
+                if (heap.size() < count) {
+                    heap.push_back(Entry{std::move(key), index, item});
+                    std::push_heap(heap.begin(), heap.end(), better);
+                } else if (KeyBefore<Descending>(key, heap.front().key)) {
+                    // equal keys never replace, the earlier item wins like a stable sort
+                    std::pop_heap(heap.begin(), heap.end(), better);
+                    heap.back() = Entry{std::move(key), index, item};
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+                index++;
+            }
+            std::sort_heap(heap.begin(), heap.end(), better);
+
+            std::vector<ItemT> result;
+            result.reserve(heap.size());
+            for (auto& entry : heap) result.push_back(std::move(entry.item));
+            return result;
+        }
+    }
+
+    /**
+     * The @param count items with the smallest keys, smallest first.
+     * Same result as OrderBy then taking count items, without sorting or copying the whole source
+     */
+    template<range T, typename F>
+    auto Top(T&& range, size_t count, F&& keySelector) {
+        return detail::TopN<false>(std::forward<T>(range), count, keySelector);
+    }
+
+    /**
+     * The @param count items with the largest keys, largest first
+     */
+    template<range T, typename F>
+    auto TopDescending(T&& range, size_t count, F&& keySelector) {
+        return detail::TopN<true>(std::forward<T>(range), count, keySelector);
+    }
+
+    /**
+     * Result of GroupBy. Groups are in the order their keys first appeared and keep their elements in source order.
+     * All elements live in one vector, grouped next to each other, and each group is a span into it.
+     * Alloc is where that vector and the key table come from
+     */
+    template<class K, class V, class Alloc = std::allocator<V>>
+    class Lookup {
+        public:
+        using Groups = FlatHashMap<K, uint32_t, Hash<K>, std::equal_to<K>, typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<K const, uint32_t>>>;
+        using Offsets = detail::rebind_vector<uint32_t, Alloc>;
+        using Elements = std::vector<V, Alloc>;
+
+        class Grouping {
+            public:
+            Grouping(K const* key, std::span<V const> elements) : key(key), elements(elements) {}
+
+            K const& Key() const {
+                return *key;
+            }
+
+            auto begin() const {
+                return elements.begin();
+            }
+
+            auto end() const {
+                return elements.end();
+            }
+
+            size_t size() const {
+                return elements.size();
+            }
+
+            V const& operator[](size_t index) const {
+                return elements[index];
+            }
+
+            private:
+            K const* key;
+            std::span<V const> elements;
+        };
+
+        struct GroupingIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = Grouping;
+            using pointer = void;
+            using reference = Grouping;
+            using iterator_category = std::forward_iterator_tag;
+
+            GroupingIterator() = default;
+            GroupingIterator(Lookup const& lookup, size_t group) : lookup(&lookup), group(group) {}
+
+            Grouping operator*() const {
+                return lookup->GetGroup(group);
+            }
+            GroupingIterator& operator++() {
+                ++group;
+                return *this;
+            }
+            GroupingIterator operator++(int) {
+                return GroupingIterator(*lookup, group++);
+            }
+            bool operator==(GroupingIterator const& other) const {
+                return group == other.group;
+            }
+
+            private:
+            Lookup const* lookup = nullptr;
+            size_t group = 0;
+        };
+
+        using iterator = GroupingIterator;
+
+        Lookup(Groups&& groups, Offsets&& offsets, Elements&& elements)
+            : groups(std::move(groups)), offsets(std::move(offsets)), elements(std::move(elements)) {}
+
+        GroupingIterator begin() const {
+            return GroupingIterator(*this, 0);
+        }
+
+        GroupingIterator end() const {
+            return GroupingIterator(*this, groups.size());
+        }
+
+        /// Number of groups
+        size_t size() const {
+            return groups.size();
+        }
+
+        bool contains(K const& key) const {
+            return groups.contains(key);
+        }
+
+        /// Elements with key, empty if there are none
+        std::span<V const> operator[](K const& key) const {
+            auto group = groups.get(key);
+            if (!group) return {};
+            return std::span<V const>(elements).subspan(offsets[*group], offsets[*group + 1] - offsets[*group]);
+        }
+
+        private:
+        // key to group number, in first seen order
+        Groups groups;
+        // group i is elements[offsets[i], offsets[i + 1])
+        Offsets offsets;
+        Elements elements;
+
+        Grouping GetGroup(size_t group) const {
+            auto const& entry = *(groups.begin() + group);
+            return Grouping(&entry.first, std::span<V const>(elements).subspan(offsets[group], offsets[group + 1] - offsets[group]));
+        }
+    };
+
+    namespace detail {
+        // GroupBy with every buffer taken from alloc
+        template<class T, class F, class E, class Alloc>
+        auto GroupInto(T&& range, F& keySelector, E& elementSelector, Alloc const& alloc) {
+            using ItemT = range_value_t<T>;
+            using K = std::remove_cvref_t<decltype(keySelector(std::declval<ItemT const&>()))>;
+            using V = std::remove_cvref_t<decltype(elementSelector(std::declval<ItemT const&>()))>;
+            using Result = Lookup<K, V, Alloc>;
+
+            typename Result::Groups groups(alloc);
+            rebind_vector<uint32_t, Alloc> groupOf(alloc);
+            // contiguous sources are read again for the scatter, anything else is staged so it's only walked once
+            constexpr bool Restage = !contiguous_range<T>;
+            typename Result::Elements staged(alloc);
+            if constexpr (can_get_size<T>) {
+                size_t size = get_size(range);
+                groupOf.reserve(size);
+                if constexpr (Restage) staged.reserve(size);
+            }
+
+            for (auto&& item : range) {
+                auto [entry, inserted] = groups.try_emplace(keySelector(item), static_cast<uint32_t>(groups.size()));
+                groupOf.push_back(entry->second);
+                if constexpr (Restage) staged.push_back(elementSelector(item));
+            }
+
+            typename Result::Offsets offsets(groups.size() + 1, 0, alloc);
+            for (uint32_t group : groupOf) offsets[group + 1]++;
+            for (size_t i = 1; i < offsets.size(); i++) offsets[i] += offsets[i - 1];
+
+            auto element = [&](size_t i) -> decltype(auto) {
+                if constexpr (Restage) return std::move(staged[i]);
+                else return elementSelector(*(range.begin() + i));
+            };
+
+            // scatter into place, the cursors start at each group's offset
+            rebind_vector<uint32_t, Alloc> cursors(offsets.begin(), offsets.end() - 1, alloc);
+            typename Result::Elements elements(alloc);
+            if constexpr (std::is_default_constructible_v<V>) {
+                elements.resize(groupOf.size());
+                for (size_t i = 0; i < groupOf.size(); i++) elements[cursors[groupOf[i]]++] = element(i);
+            } else {
+                // no default constructor to make the holes with, so walk the groups in order instead
+                rebind_vector<uint32_t, Alloc> order(groupOf.size(), alloc);
+                for (size_t i = 0; i < groupOf.size(); i++) order[cursors[groupOf[i]]++] = static_cast<uint32_t>(i);
+                elements.reserve(groupOf.size());
+                for (uint32_t index : order) elements.push_back(element(index));
+            }
+
+            return Result(std::move(groups), std::move(offsets), std::move(elements));
+        }
+    }
+
+    /**
+     * Groups elements by @param keySelector, optionally transforming each element with @param elementSelector.
+     * Keys are hashed with Sombrero::Hash, so FastVector3 and other types with a std::hash work.
+     * Uses a fixed number of allocations: one pass assigns group numbers, a counting pass lays the groups out
+     */
+    template<range T, typename F, typename E = std::identity>
+    auto GroupBy(T&& range, F&& keySelector, E&& elementSelector = {}) {
+        using ItemT = detail::range_value_t<T>;
+        using V = std::remove_cvref_t<decltype(elementSelector(std::declval<ItemT const&>()))>;
+        return detail::GroupInto(std::forward<T>(range), keySelector, elementSelector, std::allocator<V>());
+    }
+
+    /// GroupBy with the result and every buffer on the way taken from @param resource
+    template<range T, typename F, typename E>
+    auto GroupBy(T&& range, F&& keySelector, E&& elementSelector, std::pmr::memory_resource* resource) {
+        using ItemT = detail::range_value_t<T>;
+        using V = std::remove_cvref_t<decltype(elementSelector(std::declval<ItemT const&>()))>;
+        return detail::GroupInto(std::forward<T>(range), keySelector, elementSelector, std::pmr::polymorphic_allocator<V>(detail::OrHeap(resource)));
+    }
+
+    /**
+     * Set of the distinct elements, in the order they first appear. Iterating it gives the distinct sequence
+     */
+    template<range T>
+    auto ToHashSet(T&& range) {
+        using ItemT = detail::range_value_t<T>;
+        // no reserve, the source size is only an upper bound and an oversized table misses cache on every probe
+        FlatHashSet<ItemT> set;
+        for (auto&& item : range) set.insert(item);
+        return set;
+    }
+
+    /// ToHashSet with the table's storage taken from @param resource
+    template<range T>
+    auto ToHashSet(T&& range, std::pmr::memory_resource* resource) {
+        pmr::FlatHashSet<detail::range_value_t<T>> set(detail::OrHeap(resource));
+        for (auto&& item : range) set.insert(item);
+        return set;
+    }
+
+    /**
+     * Elements without duplicates, in first seen order
+     */
+    template<range T>
+    auto Distinct(T&& range) {
+        return ToHashSet(std::forward<T>(range));
+    }
+
+    template<range T>
+    auto Distinct(T&& range, std::pmr::memory_resource* resource) {
+        return ToHashSet(std::forward<T>(range), resource);
+    }
+
+    namespace detail {
+        template<class Vector, class Set, class T, class F>
+        void FillDistinctBy(Vector& result, Set& seen, T&& range, F& keySelector) {
+            for (auto&& item : range) {
+                if (seen.insert(keySelector(item)).second) result.push_back(item);
+            }
+        }
+    }
+
+    /**
+     * First element for every distinct key from @param keySelector, in first seen order
+     */
+    template<range T, typename F>
+    auto DistinctBy(T&& range, F&& keySelector) {
+        using ItemT = detail::range_value_t<T>;
+        using K = std::remove_cvref_t<decltype(keySelector(std::declval<ItemT const&>()))>;
+        FlatHashSet<K> seen;
+        std::vector<ItemT> result;
+        detail::FillDistinctBy(result, seen, range, keySelector);
+        return result;
+    }
+
+    /// DistinctBy with the result and the set of seen keys taken from @param resource
+    template<range T, typename F>
+    auto DistinctBy(T&& range, F&& keySelector, std::pmr::memory_resource* resource) {
+        using ItemT = detail::range_value_t<T>;
+        using K = std::remove_cvref_t<decltype(keySelector(std::declval<ItemT const&>()))>;
+        pmr::FlatHashSet<K> seen(detail::OrHeap(resource));
+        std::pmr::vector<ItemT> result(detail::OrHeap(resource));
+        detail::FillDistinctBy(result, seen, range, keySelector);
+        return result;
+    }
+
+    namespace detail {
+        template<class Map, class T, class F, class E>
+        void FillDictionary(Map& map, T&& range, F& keySelector, E& valueSelector) {
+            if constexpr (can_get_size<T>) map.reserve(get_size(range));
+            for (auto&& item : range) {
+                map.try_emplace_with(keySelector(item), [&] { return valueSelector(item); });
+            }
+        }
+    }
+
+    /**
+     * Map from @param keySelector to @param valueSelector (the element itself by default).
+     * Unlike C#, which throws on a repeated key, the first element with a key wins and later ones are skipped
+     * without calling @param valueSelector, so ToDictionary also works as a keyed DistinctBy
+     */
+    template<range T, typename F, typename E = std::identity>
+    auto ToDictionary(T&& range, F&& keySelector, E&& valueSelector = {}) {
+        using ItemT = detail::range_value_t<T>;
+        using K = std::remove_cvref_t<decltype(keySelector(std::declval<ItemT const&>()))>;
+        using V = std::remove_cvref_t<decltype(valueSelector(std::declval<ItemT const&>()))>;
+        FlatHashMap<K, V> map;
+        detail::FillDictionary(map, range, keySelector, valueSelector);
+        return map;
+    }
+
+    /// ToDictionary with the table's storage taken from @param resource
+    template<range T, typename F, typename E>
+    auto ToDictionary(T&& range, F&& keySelector, E&& valueSelector, std::pmr::memory_resource* resource) {
+        using ItemT = detail::range_value_t<T>;
+        using K = std::remove_cvref_t<decltype(keySelector(std::declval<ItemT const&>()))>;
+        using V = std::remove_cvref_t<decltype(valueSelector(std::declval<ItemT const&>()))>;
+        pmr::FlatHashMap<K, V> map(detail::OrHeap(resource));
+        detail::FillDictionary(map, range, keySelector, valueSelector);
+        return map;
+    }
+
+    namespace detail {
+        template<class Vector, class T, class L, class FOuter, class R>
+        void FillJoin(Vector& result, T&& outer, L const& lookup, FOuter& outerKeySelector, R& resultSelector) {
+            for (auto&& outerItem : outer) {
+                for (auto const& innerItem : lookup[outerKeySelector(outerItem)]) {
+                    result.push_back(resultSelector(outerItem, innerItem));
+                }
+            }
+        }
+    }
+
+    /**
+     * Inner join: @param resultSelector(outer, inner) for every pair whose keys match.
+     * inner is grouped once, results come in outer order, then inner order, like C#
+     */
+    template<range TOuter, range TInner, typename FOuter, typename FInner, typename R>
+    auto Join(TOuter&& outer, TInner&& inner, FOuter&& outerKeySelector, FInner&& innerKeySelector, R&& resultSelector) {
+        using OuterT = detail::range_value_t<TOuter>;
+        using InnerT = detail::range_value_t<TInner>;
+        using ResultT = std::remove_cvref_t<decltype(resultSelector(std::declval<OuterT const&>(), std::declval<InnerT const&>()))>;
+
+        auto lookup = GroupBy(inner, innerKeySelector);
+        std::vector<ResultT> result;
+        detail::FillJoin(result, outer, lookup, outerKeySelector, resultSelector);
+        return result;
+    }
+
+    /// Join with the result and the grouped inner taken from @param resource
+    template<range TOuter, range TInner, typename FOuter, typename FInner, typename R>
+    auto Join(TOuter&& outer, TInner&& inner, FOuter&& outerKeySelector, FInner&& innerKeySelector, R&& resultSelector, std::pmr::memory_resource* resource) {
+        using OuterT = detail::range_value_t<TOuter>;
+        using InnerT = detail::range_value_t<TInner>;
+        using ResultT = std::remove_cvref_t<decltype(resultSelector(std::declval<OuterT const&>(), std::declval<InnerT const&>()))>;
+
+        auto lookup = GroupBy(inner, innerKeySelector, std::identity(), resource);
+        std::pmr::vector<ResultT> result(detail::OrHeap(resource));
+        detail::FillJoin(result, outer, lookup, outerKeySelector, resultSelector);
+        return result;
+    }
+
+    namespace detail {
+        // Stages of a FusedPipeline. Push hands one item to the stage, which passes what it lets through on to emit.
+        // Push returns false once no more results can come, so the loop stops early
+        struct NoState {};
+
+        template<class F>
+        struct FusedWhere {
+            F function;
+
+            template<class In>
+            using Output = In;
+
+            NoState Start() const {
+                return {};
+            }
+
+            SizeHint Hint(SizeHint in) const {
+                return { in.count, false };
+            }
+
+            template<class T, class Emit>
+            bool Push(NoState&, T&& item, Emit&& emit) const {
+                return function(item) ? emit(std::forward<T>(item)) : true;
+            }
+        };
+
+        template<class F>
+        struct FusedSelect {
+            F function;
+
+            template<class In>
+            using Output = decltype(std::declval<F const&>()(std::declval<In>()));
+
+            NoState Start() const {
+                return {};
+            }
+
+            SizeHint Hint(SizeHint in) const {
+                return in;
+            }
+
+            template<class T, class Emit>
+            bool Push(NoState&, T&& item, Emit&& emit) const {
+                return emit(function(std::forward<T>(item)));
+            }
+        };
+
+        struct FusedTake {
+            size_t count;
+
+            template<class In>
+            using Output = In;
+
+            // how many are still to be taken
+            size_t Start() const {
+                return count;
+            }
+
+            SizeHint Hint(SizeHint in) const {
+                return { std::min(in.count, count), in.exact };
+            }
+
+            template<class T, class Emit>
+            bool Push(size_t& remaining, T&& item, Emit&& emit) const {
+                if (remaining == 0) return false;
+                remaining--;
+                return emit(std::forward<T>(item)) && remaining != 0;
+            }
+        };
+
+        struct FusedSkip {
+            size_t count;
+
+            template<class In>
+            using Output = In;
+
+            // how many are still to be skipped
+            size_t Start() const {
+                return count;
+            }
+
+            SizeHint Hint(SizeHint in) const {
+                if (in.count == SIZE_MAX) return in;
+                return { in.count > count ? in.count - count : 0, in.exact };
+            }
+
+            template<class T, class Emit>
+            bool Push(size_t& remaining, T&& item, Emit&& emit) const {
+                if (remaining != 0) {
+                    remaining--;
+                    return true;
+                }
+                return emit(std::forward<T>(item));
+            }
+        };
+
+        template<class F>
+        struct FusedTakeWhile {
+            F function;
+
+            template<class In>
+            using Output = In;
+
+            NoState Start() const {
+                return {};
+            }
+
+            SizeHint Hint(SizeHint in) const {
+                return { in.count, false };
+            }
+
+            template<class T, class Emit>
+            bool Push(NoState&, T&& item, Emit&& emit) const {
+                return function(item) && emit(std::forward<T>(item));
+            }
+        };
+
+        template<class F>
+        struct FusedSkipWhile {
+            F function;
+
+            template<class In>
+            using Output = In;
+
+            // whether it is still skipping
+            bool Start() const {
+                return true;
+            }
+
+            SizeHint Hint(SizeHint in) const {
+                return { in.count, false };
+            }
+
+            template<class T, class Emit>
+            bool Push(bool& skipping, T&& item, Emit&& emit) const {
+                if (skipping && function(item)) return true;
+                skipping = false;
+                return emit(std::forward<T>(item));
+            }
+        };
+
+        template<class Stage>
+        constexpr bool is_fused_select = false;
+
+        template<class F>
+        constexpr bool is_fused_select<FusedSelect<F>> = true;
+
+        template<class In, class... Stages>
+        struct fused_output {
+            using type = In;
+        };
+
+        template<class In, class Stage, class... Rest>
+        struct fused_output<In, Stage, Rest...> {
+            using type = typename fused_output<typename Stage::template Output<In>, Rest...>::type;
+        };
+    }
+
+    /**
+     * Where, Select, Take, Skip, TakeWhile and SkipWhile stages over a source, stored by value. Functional::Where and Select
+     * build these, and the other Functional operators add their stage when they come after one.
+     * Terminal operations (ToVector, ToArray, Count, Any, All, Sum, Min, Max, Aggregate) push each source element through every
+     * stage inside one loop body, so the compiler optimizes it like a hand written loop instead of a chain of iterators.
+     * Iterating it directly works too, one result at a time.
+     * Holds its source as noted at the top of this file
+     */
+    template<class Source, class... Stages>
+    class FusedPipeline {
+        using SourceIterator = decltype(std::declval<Source const&>().begin());
+        using SourceReference = decltype(*std::declval<SourceIterator&>());
+        using States = std::tuple<decltype(std::declval<Stages const&>().Start())...>;
+        using Output = typename detail::fused_output<SourceReference, Stages...>::type;
+
+        // only Selects: result i comes from source element i
+        constexpr static bool OneToOne = (detail::is_fused_select<Stages> && ...);
+
+        public:
+        using value_type = std::remove_cvref_t<Output>;
+
+        template<class S>
+        requires (!std::is_same_v<std::remove_cvref_t<S>, FusedPipeline>)
+        explicit FusedPipeline(S&& source, std::tuple<Stages...> stages = {}) : source(std::forward<S>(source)), stages(std::move(stages)) {}
+
+        template<typename F>
+        auto Where(F&& fn) const& {
+            return Then(*this, detail::FusedWhere<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+        template<typename F>
+        auto Where(F&& fn) && {
+            return Then(std::move(*this), detail::FusedWhere<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+
+        template<typename F>
+        auto Select(F&& fn) const& {
+            return Then(*this, detail::FusedSelect<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+        template<typename F>
+        auto Select(F&& fn) && {
+            return Then(std::move(*this), detail::FusedSelect<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+
+        /// First count results
+        auto Take(size_t count) const& {
+            return Then(*this, detail::FusedTake{count});
+        }
+        auto Take(size_t count) && {
+            return Then(std::move(*this), detail::FusedTake{count});
+        }
+
+        /// Everything after the first count results
+        auto Skip(size_t count) const& {
+            return Then(*this, detail::FusedSkip{count});
+        }
+        auto Skip(size_t count) && {
+            return Then(std::move(*this), detail::FusedSkip{count});
+        }
+
+        /// Results up to the first one that fails fn. The source isn't read any further after that
+        template<typename F>
+        auto TakeWhile(F&& fn) const& {
+            return Then(*this, detail::FusedTakeWhile<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+        template<typename F>
+        auto TakeWhile(F&& fn) && {
+            return Then(std::move(*this), detail::FusedTakeWhile<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+
+        /// Results from the first one that fails fn on
+        template<typename F>
+        auto SkipWhile(F&& fn) const& {
+            return Then(*this, detail::FusedSkipWhile<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+        template<typename F>
+        auto SkipWhile(F&& fn) && {
+            return Then(std::move(*this), detail::FusedSkipWhile<std::decay_t<F>>{std::forward<F>(fn)});
+        }
+
+        /// Pushes every result into @param sink, which returns false to stop early
+        template<class Sink>
+        void Run(Sink&& sink) const {
+            // the hint is an upper bound, so a Take(0) or an empty source reads nothing
+            if (size_hint().count == 0) return;
+            States states = Start();
+            auto end = source->end();
+            for (auto it = source->begin(); it != end; ++it) {
+                if (!Push<0>(states, *it, sink)) return;
+            }
+        }
+
+        SizeHint size_hint() const {
+            return std::apply([this](auto const&... stage) {
+                SizeHint hint = GetSizeHint(*source);
+                ((hint = stage.Hint(hint)), ...);
+                return hint;
+            }, *stages);
+        }
+
+        // Pulls results one at a time by pushing source elements through until one comes out
+        struct FusedIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = FusedPipeline::value_type;
+            // references into the source stay references, anything else is kept in the iterator
+            using reference = std::conditional_t<std::is_lvalue_reference_v<Output>, Output, value_type const&>;
+            using pointer = std::remove_reference_t<reference>*;
+            using iterator_category = std::forward_iterator_tag;
+
+            FusedIterator() = default;
+            FusedIterator(FusedPipeline const& pipeline, SourceIterator it, bool atEnd)
+                : pipeline(&pipeline), iterator(std::move(it)), states(pipeline.Start()) {
+                if (!atEnd) Advance();
+            }
+
+            reference operator*() const {
+                return *current;
+            }
+            FusedIterator& operator++() {
+                Advance();
+                return *this;
+            }
+            FusedIterator operator++(int) {
+                FusedIterator ret = *this;
+                Advance();
+                return ret;
+            }
+            bool operator==(FusedIterator const& other) const {
+                bool has = HasValue();
+                return has == other.HasValue() && (!has || iterator == other.iterator);
+            }
+
+            private:
+            FusedPipeline const* pipeline = nullptr;
+            SourceIterator iterator = {};
+            States states = {};
+            std::conditional_t<std::is_lvalue_reference_v<Output>, std::remove_reference_t<Output>*, std::optional<value_type>> current = {};
+            bool stopped = false;
+
+            bool HasValue() const {
+                return static_cast<bool>(current);
+            }
+
+            void Advance() {
+                current = {};
+                auto end = pipeline->source->end();
+                while (!HasValue() && !stopped && iterator != end) {
+                    stopped = !pipeline->template Push<0>(states, *iterator, [this](auto&& value) {
+                        if constexpr (std::is_lvalue_reference_v<Output>) current = &value;
+                        else current.emplace(std::forward<decltype(value)>(value));
+                        return true;
+                    });
+                    ++iterator;
+                }
+            }
+        };
+
+        // Used when there are only Selects. Moves like the source's iterator, so Reverse, Last and ElementAt
+        // over an array don't walk anything, and dereferencing projects just that element
+        struct MappedIterator {
+            using difference_type = std::ptrdiff_t;
+            using value_type = FusedPipeline::value_type;
+            using reference = Output;
+            using pointer = void;
+            using iterator_category = detail::propagated_category_t<SourceIterator>;
+
+            MappedIterator() = default;
+            MappedIterator(FusedPipeline const& pipeline, SourceIterator it) : pipeline(&pipeline), iterator(std::move(it)) {}
+
+            reference operator*() const {
+                return pipeline->template Map<0>(*iterator);
+            }
+            MappedIterator& operator++() {
+                ++iterator;
+                return *this;
+            }
+            MappedIterator operator++(int) {
+                MappedIterator ret = *this;
+                ++iterator;
+                return ret;
+            }
+            MappedIterator& operator--() requires (std::bidirectional_iterator<SourceIterator>) {
+                --iterator;
+                return *this;
+            }
+            MappedIterator operator--(int) requires (std::bidirectional_iterator<SourceIterator>) {
+                MappedIterator ret = *this;
+                --iterator;
+                return ret;
+            }
+            MappedIterator& operator+=(difference_type n) requires (std::random_access_iterator<SourceIterator>) {
+                iterator += n;
+                return *this;
+            }
+            MappedIterator& operator-=(difference_type n) requires (std::random_access_iterator<SourceIterator>) {
+                iterator -= n;
+                return *this;
+            }
+            MappedIterator operator+(difference_type n) const requires (std::random_access_iterator<SourceIterator>) {
+                return MappedIterator(*pipeline, iterator + n);
+            }
+            friend MappedIterator operator+(difference_type n, MappedIterator const& it) requires (std::random_access_iterator<SourceIterator>) {
+                return it + n;
+            }
+            MappedIterator operator-(difference_type n) const requires (std::random_access_iterator<SourceIterator>) {
+                return MappedIterator(*pipeline, iterator - n);
+            }
+            difference_type operator-(MappedIterator const& other) const requires (std::random_access_iterator<SourceIterator>) {
+                return iterator - other.iterator;
+            }
+            reference operator[](difference_type n) const requires (std::random_access_iterator<SourceIterator>) {
+                return pipeline->template Map<0>(iterator[n]);
+            }
+            bool operator==(MappedIterator const& other) const {
+                return iterator == other.iterator;
+            }
+            bool operator<(MappedIterator const& other) const requires (std::random_access_iterator<SourceIterator>) {
+                return iterator < other.iterator;
+            }
+            bool operator>(MappedIterator const& other) const requires (std::random_access_iterator<SourceIterator>) {
+                return iterator > other.iterator;
+            }
+            bool operator<=(MappedIterator const& other) const requires (std::random_access_iterator<SourceIterator>) {
+                return iterator <= other.iterator;
+            }
+            bool operator>=(MappedIterator const& other) const requires (std::random_access_iterator<SourceIterator>) {
+                return iterator >= other.iterator;
+            }
+
+            private:
+            FusedPipeline const* pipeline = nullptr;
+            SourceIterator iterator = {};
+        };
+
+        using iterator = std::conditional_t<OneToOne, MappedIterator, FusedIterator>;
+
+        iterator begin() const {
+            if constexpr (OneToOne) return MappedIterator(*this, source->begin());
+            else return FusedIterator(*this, source->begin(), size_hint().count == 0);
+        }
+
+        iterator end() const {
+            if constexpr (OneToOne) return MappedIterator(*this, source->end());
+            else return FusedIterator(*this, source->end(), true);
+        }
+
+        private:
+        template<class, class...>
+        friend class FusedPipeline;
+
+        detail::Stored<Source> source;
+        detail::Stored<std::tuple<Stages...>> stages;
+
+        // Extending a named pipeline references its source, like a named container, instead of copying a source it owns
+        template<class Self, class Stage>
+        static auto Then(Self&& self, Stage stage) {
+            constexpr bool Named = std::is_lvalue_reference_v<Self> || std::is_const_v<std::remove_reference_t<Self>>;
+            using NextSource = std::conditional_t<Named, Source const&, Source>;
+            using StagesRef = std::conditional_t<Named, std::tuple<Stages...> const&, std::tuple<Stages...>&&>;
+            return FusedPipeline<NextSource, Stages..., Stage>(std::forward<NextSource>(*self.source),
+                                                           std::tuple_cat(static_cast<StagesRef>(*self.stages), std::make_tuple(std::move(stage))));
+        }
+
+        States Start() const {
+            return std::apply([](auto const&... stage) { return States(stage.Start()...); }, *stages);
+        }
+
+        // Runs item through every Select from stage I on
+        template<size_t I, class T>
+        Output Map(T&& item) const {
+            if constexpr (I == sizeof...(Stages)) return std::forward<T>(item);
+            else return Map<I + 1>(std::get<I>(*stages).function(std::forward<T>(item)));
+        }
+
+        template<size_t I, class T, class Sink>
+        bool Push(States& states, T&& item, Sink&& sink) const {
+            if constexpr (I == sizeof...(Stages)) {
+                return sink(std::forward<T>(item));
+            } else {
+                return std::get<I>(*stages).Push(std::get<I>(states), std::forward<T>(item), [&](auto&& value) {
+                    return Push<I + 1>(states, std::forward<decltype(value)>(value), sink);
+                });
+            }
+        }
+    };
+
+    namespace detail {
+        template<class T>
+        constexpr bool is_fused_pipeline = false;
+
+        template<class Source, class... Stages>
+        constexpr bool is_fused_pipeline<FusedPipeline<Source, Stages...>> = true;
+    }
+
+    template<class T>
+    concept fused_pipeline = range<T> && detail::is_fused_pipeline<std::remove_cvref_t<T>>;
+
+    // Terminal operations on a FusedPipeline, each one a single loop over the source
+
+    namespace detail {
+        template<class Vector, class T>
+        void AppendPipeline(Vector& vec, T const& pipeline) {
+            SizeHint hint = pipeline.size_hint();
+            if (hint.exact) vec.reserve(vec.size() + hint.count);
+            pipeline.Run([&vec](auto&& value) {
+                vec.push_back(std::forward<decltype(value)>(value));
+                return true;
+            });
+        }
+    }
+
+    template<fused_pipeline T>
+    auto ToVector(T&& pipeline) {
+        std::vector<typename std::remove_cvref_t<T>::value_type> vec;
+        detail::AppendPipeline(vec, pipeline);
+        return vec;
+    }
+
+    template<fused_pipeline T>
+    auto ToVector(T&& pipeline, std::pmr::memory_resource* resource) {
+        std::pmr::vector<typename std::remove_cvref_t<T>::value_type> vec(detail::OrHeap(resource));
+        detail::AppendPipeline(vec, pipeline);
+        return vec;
+    }
+
+    template<fused_pipeline T>
+    auto ToArray(T&& pipeline, std::pmr::memory_resource* resource = nullptr) {
+        using ItemT = typename std::remove_cvref_t<T>::value_type;
+        SizeHint hint = pipeline.size_hint();
+        if (hint.exact) {
+            ArrayW<ItemT> arr(hint.count);
+            ItemT* out = arr.begin();
+            pipeline.Run([&out](auto&& value) {
+                *out++ = std::forward<decltype(value)>(value);
+                return true;
+            });
+            return arr;
+        }
+        auto vec = ToVector(pipeline, resource);
+        ArrayW<ItemT> arr(vec.size());
+        detail::CopyInto(vec, arr.begin());
+        return arr;
+    }
+
+    template<fused_pipeline T>
+    size_t Count(T&& pipeline) {
+        SizeHint hint = pipeline.size_hint();
+        if (hint.exact) return hint.count;
+        size_t count = 0;
+        pipeline.Run([&count](auto&&) {
+            count++;
+            return true;
+        });
+        return count;
+    }
+
+    template<fused_pipeline T, typename F>
+    bool Any(T&& pipeline, F&& fn) {
+        bool found = false;
+        pipeline.Run([&](auto&& value) {
+            found = fn(value);
+            return !found;
+        });
+        return found;
+    }
+
+    template<fused_pipeline T, typename F>
+    bool All(T&& pipeline, F&& fn) {
+        bool all = true;
+        pipeline.Run([&](auto&& value) {
+            all = fn(value);
+            return all;
+        });
+        return all;
+    }
+
+    template<fused_pipeline T, typename F = std::identity>
+    auto Sum(T&& pipeline, F&& selector = {}) {
+        using S = detail::sum_t<std::remove_cvref_t<decltype(selector(std::declval<typename std::remove_cvref_t<T>::value_type&>()))>>;
+        S total = {};
+        pipeline.Run([&](auto&& value) {
+            total = total + static_cast<S>(selector(value));
+            return true;
+        });
+        return total;
+    }
+
+    namespace detail {
+        template<bool Greater, class T, class F>
+        auto FusedExtreme(T const& pipeline, F&& selector) {
+            using K = std::remove_cvref_t<decltype(selector(std::declval<typename T::value_type&>()))>;
+            std::optional<K> best;
+            pipeline.Run([&](auto&& item) {
+                K value = selector(item);
+                if (!best || (Greater ? *best < value : value < *best)) best = std::move(value);
+                return true;
+            });
+            return best;
+        }
+    }
+
+    template<fused_pipeline T, typename F = std::identity>
+    auto Min(T&& pipeline, F&& selector = {}) {
+        return detail::FusedExtreme<false>(pipeline, selector);
+    }
+
+    template<fused_pipeline T, typename F = std::identity>
+    auto Max(T&& pipeline, F&& selector = {}) {
+        return detail::FusedExtreme<true>(pipeline, selector);
+    }
+
+    template<fused_pipeline T, typename A, typename F>
+    auto Aggregate(T&& pipeline, A seed, F&& fn) {
+        pipeline.Run([&](auto&& value) {
+            seed = fn(std::move(seed), std::forward<decltype(value)>(value));
+            return true;
+        });
+        return seed;
+    }
+
+    template<fused_pipeline T, typename F>
+    auto Aggregate(T&& pipeline, F&& fn) {
+        std::optional<typename std::remove_cvref_t<T>::value_type> result;
+        pipeline.Run([&](auto&& value) {
+            if (result) result = fn(std::move(*result), std::forward<decltype(value)>(value));
+            else result.emplace(std::forward<decltype(value)>(value));
+            return true;
+        });
+        return result;
+    }
+
+    namespace detail {
+        // Calls fn on each element until it returns false. A FusedPipeline does it in its fused loop
+        template<class T, class F>
+        void ForEachWhile(T&& range, F&& fn) {
+            if constexpr (fused_pipeline<T>) {
+                range.Run(fn);
+            } else {
+                for (auto&& item : range) {
+                    if (!fn(item)) return;
+                }
+            }
+        }
+    }
+
+    /**
+     * Copies the range into a SmallVector, which keeps up to @tparam N elements inside itself and only allocates past that.
+     * Meant for queries in hot code that usually give a handful of results
+     */
+    template<size_t N, class T>
+    requires (range<T>)
+    auto ToSmallVector(T&& range) {
+        SmallVector<detail::range_value_t<T>, N> vec;
+        SizeHint hint = GetSizeHint(range);
+        if (hint.exact) vec.reserve(hint.count);
+        detail::ForEachWhile(range, [&vec](auto&& item) {
+            vec.push_back(std::forward<decltype(item)>(item));
+            return true;
+        });
+        return vec;
+    }
+
+    /**
+     * Copies the range into an InplaceVector, which never allocates.
+     * @return nullopt if there are more than @tparam N elements. The source isn't read past the first one that doesn't fit
+     */
+    template<size_t N, class T>
+    requires (range<T>)
+    auto ToInplace(T&& range) {
+        using Result = InplaceVector<detail::range_value_t<T>, N>;
+        SizeHint hint = GetSizeHint(range);
+        if (hint.exact && hint.count > N) return std::optional<Result>();
+        std::optional<Result> result(std::in_place);
+        bool fits = true;
+        detail::ForEachWhile(range, [&](auto&& item) {
+            fits = result->TryPush(std::forward<decltype(item)>(item));
+            return fits;
+        });
+        if (!fits) result.reset();
+        return result;
+    }
+
+    /**
+     * Copies the range into a std::array, for results whose size is known when compiling, like a Select over a fixed set of points.
+     * @return nullopt unless there are exactly @tparam N elements. The source isn't read past element N + 1
+     */
+    template<size_t N, class T>
+    requires (range<T>)
+    auto ToStaticArray(T&& range) {
+        using Result = std::array<detail::range_value_t<T>, N>;
+        SizeHint hint = GetSizeHint(range);
+        if (hint.exact && hint.count != N) return std::optional<Result>();
+        std::optional<Result> result(std::in_place);
+        size_t count = 0;
+        detail::ForEachWhile(range, [&](auto&& item) {
+            if (count == N) {
+                count++;
+                return false;
+            }
+            (*result)[count++] = std::forward<decltype(item)>(item);
+            return true;
+        });
+        if (count != N) result.reset();
+        return result;
+    }
+
+    namespace detail {
+        struct ParallelOptions {
+            // most threads, the caller included. 0 uses the whole pool
+            size_t degree = 0;
+            // elements per work item, 0 picks one from the source size
+            size_t chunkSize = 0;
+            // nullptr uses ThreadPool::Shared()
+            ThreadPool* pool = nullptr;
+        };
+
+        // Per element steps of a ParallelQuery. Each one hands the values it lets through to emit
+        struct ParallelSource {
+            template<class T, class Emit>
+            void operator()(T&& item, Emit&& emit) const {
+                emit(std::forward<T>(item));
+            }
+        };
+
+        template<class Previous, class F>
+        struct ParallelWhere {
+            Previous previous;
+            F function;
+
+            template<class T, class Emit>
+            void operator()(T&& item, Emit&& emit) const {
+                previous(std::forward<T>(item), [&](auto&& value) {
+                    if (function(value)) emit(std::forward<decltype(value)>(value));
+                });
+            }
+        };
+
+        template<class Previous, class F>
+        struct ParallelSelect {
+            Previous previous;
+            F function;
+
+            template<class T, class Emit>
+            void operator()(T&& item, Emit&& emit) const {
+                previous(std::forward<T>(item), [&](auto&& value) {
+                    emit(function(std::forward<decltype(value)>(value)));
+                });
+            }
+        };
+    }
+
+    /**
+     * Result of AsParallel. Where and Select only record their functions. The work runs when a terminal operation is called:
+     * the source is cut into chunks, the chunks run on a ThreadPool and the results come back in source order.
+     * Chunks only depend on the source size and chunk size, so float Sums come out the same for any thread count.
+     * The functions run on several threads at once, so they must not write shared state or call into il2cpp.
+     * Holds its source as noted at the top of this file. Where and Select on a named query reference its source, like FusedPipeline
+     */
+    template<class Source, class Value, class Pipeline, bool Filtered>
+    class ParallelQuery {
+        template<class, class, class, bool>
+        friend class ParallelQuery;
+
+        public:
+        using value_type = Value;
+
+        template<class S>
+        ParallelQuery(S&& source, Pipeline pipeline, detail::ParallelOptions options)
+            : source(std::forward<S>(source)), pipeline(std::move(pipeline)), options(options) {
+            count = this->source->end() - this->source->begin();
+        }
+
+        template<typename F>
+        auto Where(F&& fn) const& {
+            return Then<Value, true>(*this, detail::ParallelWhere<Pipeline, std::decay_t<F>>{pipeline, std::forward<F>(fn)});
+        }
+        template<typename F>
+        auto Where(F&& fn) && {
+            return Then<Value, true>(std::move(*this), detail::ParallelWhere<Pipeline, std::decay_t<F>>{std::move(pipeline), std::forward<F>(fn)});
+        }
+
+        template<typename F>
+        auto Select(F&& fn) const& {
+            using R = std::remove_cvref_t<decltype(fn(std::declval<Value&>()))>;
+            return Then<R, Filtered>(*this, detail::ParallelSelect<Pipeline, std::decay_t<F>>{pipeline, std::forward<F>(fn)});
+        }
+        template<typename F>
+        auto Select(F&& fn) && {
+            using R = std::remove_cvref_t<decltype(fn(std::declval<Value&>()))>;
+            return Then<R, Filtered>(std::move(*this), detail::ParallelSelect<Pipeline, std::decay_t<F>>{std::move(pipeline), std::forward<F>(fn)});
+        }
+
+        /// Most threads used, the caller included. 0 uses the whole pool
+        ParallelQuery WithDegreeOfParallelism(size_t degree) const& {
+            return ParallelQuery(*this).WithDegreeOfParallelism(degree);
+        }
+        ParallelQuery WithDegreeOfParallelism(size_t degree) && {
+            options.degree = degree;
+            return std::move(*this);
+        }
+
+        /// Elements per work item. Smaller evens out uneven work better, larger has less overhead. 0 picks one from the source size
+        ParallelQuery WithChunkSize(size_t chunkSize) const& {
+            return ParallelQuery(*this).WithChunkSize(chunkSize);
+        }
+        ParallelQuery WithChunkSize(size_t chunkSize) && {
+            options.chunkSize = chunkSize;
+            return std::move(*this);
+        }
+
+        /// Runs on @param pool instead of ThreadPool::Shared()
+        ParallelQuery WithPool(ThreadPool& pool) const& {
+            return ParallelQuery(*this).WithPool(pool);
+        }
+        ParallelQuery WithPool(ThreadPool& pool) && {
+            options.pool = &pool;
+            return std::move(*this);
+        }
+
+        std::vector<Value> ToVector() const {
+            // vector<bool> packs bits, so chunks next to each other would write the same bytes
+            constexpr bool WriteInPlace = std::is_default_constructible_v<Value> && !std::is_same_v<Value, bool>;
+            if constexpr (!Filtered && WriteInPlace) {
+                std::vector<Value> result(count);
+                WriteUnfiltered(result.data());
+                return result;
+            } else {
+                auto [buffers, offsets] = CollectChunks();
+                std::vector<Value> result;
+                if constexpr (WriteInPlace) {
+                    result.resize(offsets.back());
+                    MoveChunks(buffers, offsets, result.data());
+                } else {
+                    result.reserve(offsets.back());
+                    for (auto& buffer : buffers) std::move(buffer.begin(), buffer.end(), std::back_inserter(result));
+                }
+                return result;
+            }
+        }
+
+        ArrayW<Value> ToArray() const {
+            if constexpr (!Filtered) {
+                ArrayW<Value> result(count);
+                WriteUnfiltered(result.begin());
+                return result;
+            } else {
+                auto [buffers, offsets] = CollectChunks();
+                ArrayW<Value> result(offsets.back());
+                MoveChunks(buffers, offsets, result.begin());
+                return result;
+            }
+        }
+
+        /// Number of results. Without a Where this is the source size and nothing runs
+        size_t Count() const {
+            if constexpr (!Filtered) {
+                return count;
+            } else {
+                size_t total = 0;
+                for (size_t found : FoldChunks(size_t(0), [](size_t& found, auto&&) { found++; })) total += found;
+                return total;
+            }
+        }
+
+        /// Whether any result satisfies @param fn. Chunks stop early once one is found
+        template<typename F>
+        bool Any(F&& fn) const {
+            std::atomic<bool> found = false;
+            ForEachChunk([&](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end && !found.load(std::memory_order_relaxed); i++) {
+                    pipeline(At(i), [&](auto&& value) {
+                        if (fn(value)) found.store(true, std::memory_order_relaxed);
+                    });
+                }
+            });
+            return found.load();
+        }
+
+        template<typename F>
+        bool All(F&& fn) const {
+            return !Any([&fn](auto&& value) { return !fn(value); });
+        }
+
+        /// Sum of the results, or of @param selector applied to them. Each chunk is summed on its own, then the chunks in order
+        template<typename F = std::identity>
+        auto Sum(F&& selector = {}) const {
+            using S = detail::sum_t<std::remove_cvref_t<decltype(selector(std::declval<Value&>()))>>;
+            auto partials = FoldChunks(S{}, [&selector](S& total, auto&& value) { total = total + static_cast<S>(selector(value)); });
+            S total = {};
+            for (auto const& partial : partials) total = total + partial;
+            return total;
+        }
+
+        /// @return nullopt if there are no results
+        template<typename F = std::identity>
+        auto Min(F&& selector = {}) const {
+            return Extreme<false>(selector);
+        }
+
+        /// @return nullopt if there are no results
+        template<typename F = std::identity>
+        auto Max(F&& selector = {}) const {
+            return Extreme<true>(selector);
+        }
+
+        /**
+         * Folds each chunk into a copy of @param seed with @param fn, then folds the chunk results together in order with @param combine.
+         * seed has to be neutral for combine, like 0 for a sum
+         */
+        template<typename A, typename F, typename C>
+        A Aggregate(A seed, F&& fn, C&& combine) const {
+            auto partials = FoldChunks(seed, [&fn](A& total, auto&& value) { total = fn(std::move(total), std::forward<decltype(value)>(value)); });
+            for (auto& partial : partials) seed = combine(std::move(seed), std::move(partial));
+            return seed;
+        }
+
+        /// Calls @param fn on every result, from several threads and in no particular order
+        template<typename F>
+        void ForEach(F&& fn) const {
+            ForEachChunk([&](size_t, size_t begin, size_t end) { Run(begin, end, fn); });
+        }
+
+        private:
+        using SourceIterator = detail::source_iterator_t<Source>;
+
+        detail::Stored<Source> source;
+        size_t count;
+        Pipeline pipeline;
+        detail::ParallelOptions options;
+
+        // A named query lends its source to the next one, a temporary moves it along
+        template<class R, bool NextFiltered, class Self, class Next>
+        static auto Then(Self&& self, Next next) {
+            constexpr bool Named = std::is_lvalue_reference_v<Self> || std::is_const_v<std::remove_reference_t<Self>>;
+            using NextSource = std::conditional_t<Named, Source const&, Source>;
+            return ParallelQuery<NextSource, R, Next, NextFiltered>(std::forward<NextSource>(*self.source), std::move(next), self.options);
+        }
+
+        ThreadPool& Pool() const {
+            return options.pool ? *options.pool : ThreadPool::Shared();
+        }
+
+        decltype(auto) At(size_t index) const {
+            return source->begin()[static_cast<std::iter_difference_t<SourceIterator>>(index)];
+        }
+
+        size_t ChunkSize() const {
+            return options.chunkSize != 0 ? options.chunkSize : std::max<size_t>(1024, count / 256);
+        }
+
+        size_t ChunkCount() const {
+            return (count + ChunkSize() - 1) / ChunkSize();
+        }
+
+        // fn(chunk, begin, end) for every chunk, spread over the pool
+        template<class F>
+        void ForEachChunk(F&& fn) const {
+            size_t chunkSize = ChunkSize();
+            Pool().ParallelFor(ChunkCount(), [&](size_t chunk) {
+                size_t begin = chunk * chunkSize;
+                fn(chunk, begin, std::min(count, begin + chunkSize));
+            }, options.degree);
+        }
+
+        template<class Emit>
+        void Run(size_t begin, size_t end, Emit&& emit) const {
+            for (size_t i = begin; i < end; i++) pipeline(At(i), emit);
+        }
+
+        // Folds each chunk into its own copy of init. The running value stays local so threads don't share cache lines
+        template<class A, class F>
+        std::vector<A> FoldChunks(A const& init, F&& fn) const {
+            std::vector<A> partials(ChunkCount(), init);
+            ForEachChunk([&](size_t chunk, size_t begin, size_t end) {
+                A total = init;
+                Run(begin, end, [&](auto&& value) { fn(total, std::forward<decltype(value)>(value)); });
+                partials[chunk] = std::move(total);
+            });
+            return partials;
+        }
+
+        // Without a Where every element makes exactly one result, so each chunk writes straight to its place
+        template<class Out>
+        void WriteUnfiltered(Out out) const {
+            ForEachChunk([&](size_t, size_t begin, size_t end) {
+                auto it = out + begin;
+                Run(begin, end, [&it](auto&& value) { *it++ = std::forward<decltype(value)>(value); });
+            });
+        }
+
+        // Results of each chunk, and where each chunk starts in the output. offsets.back() is the total
+        std::pair<std::vector<std::vector<Value>>, std::vector<size_t>> CollectChunks() const {
+            std::vector<std::vector<Value>> buffers(ChunkCount());
+            ForEachChunk([&](size_t chunk, size_t begin, size_t end) {
+                auto& buffer = buffers[chunk];
+                Run(begin, end, [&buffer](auto&& value) { buffer.emplace_back(std::forward<decltype(value)>(value)); });
+            });
+            std::vector<size_t> offsets(buffers.size() + 1, 0);
+            for (size_t i = 0; i < buffers.size(); i++) offsets[i + 1] = offsets[i] + buffers[i].size();
+            return { std::move(buffers), std::move(offsets) };
+        }
+
+        template<class Out>
+        void MoveChunks(std::vector<std::vector<Value>>& buffers, std::vector<size_t> const& offsets, Out out) const {
+            Pool().ParallelFor(buffers.size(), [&](size_t chunk) {
+                std::move(buffers[chunk].begin(), buffers[chunk].end(), out + offsets[chunk]);
+            }, options.degree);
+        }
+
+        template<bool Greater, class F>
+        auto Extreme(F& selector) const {
+            using K = std::remove_cvref_t<decltype(selector(std::declval<Value&>()))>;
+            auto keep = [](std::optional<K>& best, K value) {
+                if (!best || (Greater ? *best < value : value < *best)) best = std::move(value);
+            };
+            auto partials = FoldChunks(std::optional<K>(), [&](std::optional<K>& best, auto&& value) { keep(best, selector(value)); });
+            std::optional<K> best;
+            for (auto& partial : partials) {
+                if (partial) keep(best, std::move(*partial));
+            }
+            return best;
+        }
+    };
+
+    namespace detail {
+        template<class T>
+        constexpr bool is_parallel_query = false;
+
+        template<class Source, class Value, class Pipeline, bool Filtered>
+        constexpr bool is_parallel_query<ParallelQuery<Source, Value, Pipeline, Filtered>> = true;
+    }
+
+    template<class T>
+    concept parallel_query = detail::is_parallel_query<std::remove_cvref_t<T>>;
+
+    /**
+     * Starts a parallel query over a random access source such as ArrayW or std::vector, see ParallelQuery.
+     * Pays off for heavy functions or large sources. For cheap lambdas over a few thousand elements the sequential operators win.
+     * @param degree most threads used, the caller included. 0 uses the whole shared pool
+     */
+    template<range T>
+    requires (std::random_access_iterator<decltype(std::declval<T&>().begin())>)
+    auto AsParallel(T&& range, size_t degree = 0) {
+        return ParallelQuery<T, detail::range_value_t<T>, detail::ParallelSource, false>(std::forward<T>(range), {}, { .degree = degree });
+    }
+
+    namespace detail {
+        // These iterables hand out iterators built only from their sources' iterators, so the iterators stay valid after the iterable
+        // is gone as long as the source does: it is referenced, or borrowed itself
+        template<class Source>
+        constexpr bool borrows_source = std::is_lvalue_reference_v<Source> || std::ranges::enable_borrowed_range<std::remove_cv_t<Source>>;
+    }
+}
+
+// Lets std::ranges algorithms return iterators into these when they are passed as temporaries
+namespace std::ranges {
+    template<class I>
+    inline constexpr bool enable_borrowed_range<Sombrero::Linq::IteratorRange<I>> = true;
+
+    template<class Source>
+    inline constexpr bool enable_borrowed_range<Sombrero::Linq::ReverseIterable<Source>> = Sombrero::Linq::detail::borrows_source<Source>;
+
+    template<class Source>
+    inline constexpr bool enable_borrowed_range<Sombrero::Linq::TakeIterable<Source>> = Sombrero::Linq::detail::borrows_source<Source>;
+
+    template<class Source>
+    inline constexpr bool enable_borrowed_range<Sombrero::Linq::SkipIterable<Source>> = Sombrero::Linq::detail::borrows_source<Source>;
+
+    template<class Source, class F>
+    inline constexpr bool enable_borrowed_range<Sombrero::Linq::SkipWhileIterable<Source, F>> = Sombrero::Linq::detail::borrows_source<Source>;
+
+    template<class... Sources>
+    inline constexpr bool enable_borrowed_range<Sombrero::Linq::ZipIterable<Sources...>> = (Sombrero::Linq::detail::borrows_source<Sources> && ...);
+}
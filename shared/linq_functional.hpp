@@ -6,6 +6,8 @@
 // Holds the functional wrappers for performing transformations on ranges
 namespace Sombrero::Linq::Functional {
 
+    // Where and Select build a FusedPipeline, which runs all of them in one loop. Take, Skip, TakeWhile and SkipWhile join
+    // a pipeline that is already there, and otherwise wrap the range directly so a random access source stays random access
     template<class F>
     struct Where {
         F function;
@@ -13,7 +15,17 @@ namespace Sombrero::Linq::Functional {
         template<class T>
         requires (Sombrero::Linq::range<T>)
         auto transform(T&& range) {
-            return Sombrero::Linq::WhereIterable<decltype(range.begin()), F>(range, std::forward<F>(function));
+            return Sombrero::Linq::FusedPipeline<T>(std::forward<T>(range)).Where(std::forward<F>(function));
+        }
+        template<class T>
+        requires (Sombrero::Linq::fused_pipeline<T>)
+        auto transform(T&& pipeline) {
+            return std::forward<T>(pipeline).Where(std::forward<F>(function));
+        }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return std::forward<T>(query).Where(std::forward<F>(function));
         }
     };
     template<class F>
@@ -23,7 +35,119 @@ namespace Sombrero::Linq::Functional {
         template<class T>
         requires (Sombrero::Linq::range<T>)
         auto transform(T&& range) {
-            return Sombrero::Linq::SelectIterable<decltype(range.begin()), F, decltype(function(*range.begin()))>(range, std::forward<F>(function));
+            return Sombrero::Linq::FusedPipeline<T>(std::forward<T>(range)).Select(std::forward<F>(function));
+        }
+        template<class T>
+        requires (Sombrero::Linq::fused_pipeline<T>)
+        auto transform(T&& pipeline) {
+            return std::forward<T>(pipeline).Select(std::forward<F>(function));
+        }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return std::forward<T>(query).Select(std::forward<F>(function));
+        }
+    };
+
+    struct Take {
+        size_t count;
+        explicit Take(size_t count) : count(count) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Take(std::forward<T>(range), count);
+        }
+        template<class T>
+        requires (Sombrero::Linq::fused_pipeline<T>)
+        auto transform(T&& pipeline) {
+            return std::forward<T>(pipeline).Take(count);
+        }
+    };
+
+    struct Skip {
+        size_t count;
+        explicit Skip(size_t count) : count(count) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Skip(std::forward<T>(range), count);
+        }
+        template<class T>
+        requires (Sombrero::Linq::fused_pipeline<T>)
+        auto transform(T&& pipeline) {
+            return std::forward<T>(pipeline).Skip(count);
+        }
+    };
+
+    template<class F>
+    struct TakeWhile {
+        F function;
+        explicit TakeWhile(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::TakeWhile(std::forward<T>(range), std::forward<F>(function));
+        }
+        template<class T>
+        requires (Sombrero::Linq::fused_pipeline<T>)
+        auto transform(T&& pipeline) {
+            return std::forward<T>(pipeline).TakeWhile(std::forward<F>(function));
+        }
+    };
+
+    template<class F>
+    struct SkipWhile {
+        F function;
+        explicit SkipWhile(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::SkipWhile(std::forward<T>(range), std::forward<F>(function));
+        }
+        template<class T>
+        requires (Sombrero::Linq::fused_pipeline<T>)
+        auto transform(T&& pipeline) {
+            return std::forward<T>(pipeline).SkipWhile(std::forward<F>(function));
+        }
+    };
+
+    struct Chunk {
+        size_t size;
+        explicit Chunk(size_t size) : size(size) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Chunk(std::forward<T>(range), size);
+        }
+    };
+
+    struct Window {
+        size_t size;
+        explicit Window(size_t size) : size(size) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Window(std::forward<T>(range), size);
+        }
+    };
+
+    template<class F>
+    struct SelectCached {
+        F function;
+        explicit SelectCached(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::SelectIterable<decltype(range.begin()), F, decltype(function(*range.begin())), true>(range, std::forward<F>(function));
+        }
+    };
+
+    struct Memoize {
+        explicit Memoize() {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Memoize(std::forward<T>(range));
         }
     };
 
@@ -51,7 +175,7 @@ namespace Sombrero::Linq::Functional {
         }
     };
 
-    template<class F>
+    template<class F = void>
     struct Last {
         F function;
         explicit Last(F&& func) : function(func) {}
@@ -63,6 +187,19 @@ namespace Sombrero::Linq::Functional {
         }
     };
 
+    // Without a function the last element is taken
+    template<>
+    struct Last<void> {
+        explicit Last() {}
+
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Last(std::forward<T>(range));
+        }
+    };
+    Last() -> Last<void>;
+
     template<class F>
     struct LastOrDefault {
         F function;
@@ -75,6 +212,27 @@ namespace Sombrero::Linq::Functional {
         }
     };
 
+    struct ElementAt {
+        size_t index;
+        explicit ElementAt(size_t index) : index(index) {}
+
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::ElementAt(std::forward<T>(range), index);
+        }
+    };
+
+    struct ElementAtOrDefault {
+        size_t index;
+        explicit ElementAtOrDefault(size_t index) : index(index) {}
+
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::ElementAtOrDefault(std::forward<T>(range), index);
+        }
+    };
 
     template<class F>
     struct Any {
@@ -86,6 +244,11 @@ namespace Sombrero::Linq::Functional {
         auto transform(T&& range) {
             return Sombrero::Linq::Any(std::forward<T>(range), function);
         }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return query.Any(function);
+        }
     };
 
     template<class F>
@@ -98,6 +261,11 @@ namespace Sombrero::Linq::Functional {
         auto transform(T&& range) {
             return Sombrero::Linq::All(std::forward<T>(range), function);
         }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return query.All(function);
+        }
     };
 
     struct Reverse {
@@ -109,20 +277,66 @@ namespace Sombrero::Linq::Functional {
         }
     };
 
+    // resource is where a source of unknown size is buffered, nullptr uses the heap
     struct ToArray {
-        explicit ToArray() {}
+        std::pmr::memory_resource* resource;
+        explicit ToArray(std::pmr::memory_resource* resource = nullptr) : resource(resource) {}
         template<class T>
         requires (Sombrero::Linq::range<T>)
         auto transform(T&& range) {
-            return Sombrero::Linq::ToArray(std::forward<T>(range));
+            return Sombrero::Linq::ToArray(std::forward<T>(range), resource);
+        }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return query.ToArray();
         }
     };
+    // With a memory_resource, such as a FrameArena, the result is a std::pmr::vector using it
+    template<class Resource = void>
     struct ToVector {
-        explicit ToVector() {}
+        std::pmr::memory_resource* resource = nullptr;
+        explicit ToVector() requires (std::is_void_v<Resource>) {}
+        explicit ToVector(std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::ToVector(std::forward<T>(range));
+            else return Sombrero::Linq::ToVector(std::forward<T>(range), resource);
+        }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T> && std::is_void_v<Resource>)
+        auto transform(T&& query) {
+            return query.ToVector();
+        }
+    };
+    ToVector() -> ToVector<void>;
+    ToVector(std::pmr::memory_resource*) -> ToVector<std::pmr::memory_resource>;
+    template<size_t N>
+    struct ToSmallVector {
+        explicit ToSmallVector() {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::ToSmallVector<N>(std::forward<T>(range));
+        }
+    };
+    template<size_t N>
+    struct ToInplace {
+        explicit ToInplace() {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::ToInplace<N>(std::forward<T>(range));
+        }
+    };
+    template<size_t N>
+    struct ToStaticArray {
+        explicit ToStaticArray() {}
         template<class T>
         requires (Sombrero::Linq::range<T>)
         auto transform(T&& range) {
-            return Sombrero::Linq::ToVector(std::forward<T>(range));
+            return Sombrero::Linq::ToStaticArray<N>(std::forward<T>(range));
         }
     };
     struct Count {
@@ -132,18 +346,383 @@ namespace Sombrero::Linq::Functional {
         auto transform(T&& range) {
             return Sombrero::Linq::Count(std::forward<T>(range));
         }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return query.Count();
+        }
     };
+    // resource is where a source of unknown size is buffered, nullptr uses the heap
     struct ToList {
-        explicit ToList() {}
+        std::pmr::memory_resource* resource;
+        explicit ToList(std::pmr::memory_resource* resource = nullptr) : resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::ToList(std::forward<T>(range), resource);
+        }
+    };
+    template<class F = std::identity>
+    struct Sum {
+        F function;
+        explicit Sum(F&& func = {}) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Sum(std::forward<T>(range), function);
+        }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return query.Sum(function);
+        }
+    };
+
+    template<class F = std::identity>
+    struct Average {
+        F function;
+        explicit Average(F&& func = {}) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Average(std::forward<T>(range), function);
+        }
+    };
+
+    template<class F = std::identity>
+    struct Min {
+        F function;
+        explicit Min(F&& func = {}) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Min(std::forward<T>(range), function);
+        }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return query.Min(function);
+        }
+    };
+
+    template<class F = std::identity>
+    struct Max {
+        F function;
+        explicit Max(F&& func = {}) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Max(std::forward<T>(range), function);
+        }
+        template<class T>
+        requires (Sombrero::Linq::parallel_query<T>)
+        auto transform(T&& query) {
+            return query.Max(function);
+        }
+    };
+
+    template<class F>
+    struct MinBy {
+        F function;
+        explicit MinBy(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::MinBy(std::forward<T>(range), function);
+        }
+    };
+
+    template<class F>
+    struct MaxBy {
+        F function;
+        explicit MaxBy(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::MaxBy(std::forward<T>(range), function);
+        }
+    };
+
+    template<class F, class A = void>
+    struct Aggregate {
+        A seed;
+        F function;
+        explicit Aggregate(A seed, F&& func) : seed(std::move(seed)), function(func) {}
         template<class T>
         requires (Sombrero::Linq::range<T>)
         auto transform(T&& range) {
-            return Sombrero::Linq::ToList(std::forward<T>(range));
+            return Sombrero::Linq::Aggregate(std::forward<T>(range), seed, function);
         }
     };
+
+    // Without a seed the first element is used
+    template<class F>
+    struct Aggregate<F, void> {
+        F function;
+        explicit Aggregate(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Aggregate(std::forward<T>(range), function);
+        }
+    };
+    template<class A, class F>
+    Aggregate(A, F&&) -> Aggregate<F, A>;
+    template<class F>
+    Aggregate(F&&) -> Aggregate<F, void>;
+
+    template<class F, class Resource = void>
+    struct OrderBy {
+        F function;
+        std::pmr::memory_resource* resource = nullptr;
+        explicit OrderBy(F&& func) requires (std::is_void_v<Resource>) : function(func) {}
+        explicit OrderBy(F&& func, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : function(func), resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::OrderBy(std::forward<T>(range), function);
+            else return Sombrero::Linq::OrderBy(std::forward<T>(range), function, resource);
+        }
+    };
+    template<class F>
+    OrderBy(F, std::pmr::memory_resource*) -> OrderBy<F, std::pmr::memory_resource>;
+
+    template<class F, class Resource = void>
+    struct OrderByDescending {
+        F function;
+        std::pmr::memory_resource* resource = nullptr;
+        explicit OrderByDescending(F&& func) requires (std::is_void_v<Resource>) : function(func) {}
+        explicit OrderByDescending(F&& func, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : function(func), resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::OrderByDescending(std::forward<T>(range), function);
+            else return Sombrero::Linq::OrderByDescending(std::forward<T>(range), function, resource);
+        }
+    };
+    template<class F>
+    OrderByDescending(F, std::pmr::memory_resource*) -> OrderByDescending<F, std::pmr::memory_resource>;
+
+    template<class F>
+    struct ThenBy {
+        F function;
+        explicit ThenBy(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::ordered_iterable<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::ThenBy(std::forward<T>(range), function);
+        }
+    };
+
+    template<class F>
+    struct ThenByDescending {
+        F function;
+        explicit ThenByDescending(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::ordered_iterable<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::ThenByDescending(std::forward<T>(range), function);
+        }
+    };
+
+    template<class F>
+    struct Top {
+        size_t count;
+        F function;
+        explicit Top(size_t count, F&& func) : count(count), function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Top(std::forward<T>(range), count, function);
+        }
+    };
+
+    template<class F>
+    struct TopDescending {
+        size_t count;
+        F function;
+        explicit TopDescending(size_t count, F&& func) : count(count), function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::TopDescending(std::forward<T>(range), count, function);
+        }
+    };
+
+    // With a memory_resource, such as a FrameArena, the groups and every buffer on the way come from it
+    template<class F, class E = std::identity, class Resource = void>
+    struct GroupBy {
+        F function;
+        E element;
+        std::pmr::memory_resource* resource = nullptr;
+        explicit GroupBy(F&& func, E&& elementFunc = {}) requires (std::is_void_v<Resource>) : function(func), element(elementFunc) {}
+        explicit GroupBy(F&& func, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : function(func), element(), resource(resource) {}
+        explicit GroupBy(F&& func, E&& elementFunc, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : function(func), element(elementFunc), resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::GroupBy(std::forward<T>(range), function, element);
+            else return Sombrero::Linq::GroupBy(std::forward<T>(range), function, element, resource);
+        }
+    };
+    // takes any resource pointer, so a FrameArena* isn't mistaken for the second function
+    template<class F, class M>
+    requires (std::is_convertible_v<M*, std::pmr::memory_resource*>)
+    GroupBy(F, M*) -> GroupBy<F, std::identity, std::pmr::memory_resource>;
+    template<class F, class E>
+    GroupBy(F, E, std::pmr::memory_resource*) -> GroupBy<F, E, std::pmr::memory_resource>;
+
+    // With a memory_resource the result is a Sombrero::pmr::FlatHashSet using it
+    template<class Resource = void>
+    struct Distinct {
+        std::pmr::memory_resource* resource = nullptr;
+        explicit Distinct() requires (std::is_void_v<Resource>) {}
+        explicit Distinct(std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::Distinct(std::forward<T>(range));
+            else return Sombrero::Linq::Distinct(std::forward<T>(range), resource);
+        }
+    };
+    Distinct() -> Distinct<void>;
+    Distinct(std::pmr::memory_resource*) -> Distinct<std::pmr::memory_resource>;
+
+    template<class F, class Resource = void>
+    struct DistinctBy {
+        F function;
+        std::pmr::memory_resource* resource = nullptr;
+        explicit DistinctBy(F&& func) requires (std::is_void_v<Resource>) : function(func) {}
+        explicit DistinctBy(F&& func, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : function(func), resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::DistinctBy(std::forward<T>(range), function);
+            else return Sombrero::Linq::DistinctBy(std::forward<T>(range), function, resource);
+        }
+    };
+    template<class F>
+    DistinctBy(F, std::pmr::memory_resource*) -> DistinctBy<F, std::pmr::memory_resource>;
+
+    // With a memory_resource the result is a Sombrero::pmr::FlatHashSet using it
+    template<class Resource = void>
+    struct ToHashSet {
+        std::pmr::memory_resource* resource = nullptr;
+        explicit ToHashSet() requires (std::is_void_v<Resource>) {}
+        explicit ToHashSet(std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::ToHashSet(std::forward<T>(range));
+            else return Sombrero::Linq::ToHashSet(std::forward<T>(range), resource);
+        }
+    };
+    ToHashSet() -> ToHashSet<void>;
+    ToHashSet(std::pmr::memory_resource*) -> ToHashSet<std::pmr::memory_resource>;
+
+    // With a memory_resource the result is a Sombrero::pmr::FlatHashMap using it
+    template<class F, class E = std::identity, class Resource = void>
+    struct ToDictionary {
+        F function;
+        E value;
+        std::pmr::memory_resource* resource = nullptr;
+        explicit ToDictionary(F&& func, E&& valueFunc = {}) requires (std::is_void_v<Resource>) : function(func), value(valueFunc) {}
+        explicit ToDictionary(F&& func, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : function(func), value(), resource(resource) {}
+        explicit ToDictionary(F&& func, E&& valueFunc, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>) : function(func), value(valueFunc), resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::ToDictionary(std::forward<T>(range), function, value);
+            else return Sombrero::Linq::ToDictionary(std::forward<T>(range), function, value, resource);
+        }
+    };
+    // takes any resource pointer, so a FrameArena* isn't mistaken for the second function
+    template<class F, class M>
+    requires (std::is_convertible_v<M*, std::pmr::memory_resource*>)
+    ToDictionary(F, M*) -> ToDictionary<F, std::identity, std::pmr::memory_resource>;
+    template<class F, class E>
+    ToDictionary(F, E, std::pmr::memory_resource*) -> ToDictionary<F, E, std::pmr::memory_resource>;
+
+    // The other sources are held by reference, they have to outlive the result
+    template<class... Others>
+    struct Zip {
+        std::tuple<Others&...> others;
+        explicit Zip(Others&... others) : others(others...) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return std::apply([&range](Others&... others) { return Sombrero::Linq::Zip(std::forward<T>(range), others...); }, others);
+        }
+    };
+
+    // second is held by reference, it has to outlive the result
+    template<class Second>
+    struct Concat {
+        Second& second;
+        explicit Concat(Second& second) : second(second) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::Concat(std::forward<T>(range), second);
+        }
+    };
+
+    template<class F>
+    struct SelectMany {
+        F function;
+        explicit SelectMany(F&& func) : function(func) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::SelectMany(std::forward<T>(range), std::forward<F>(function));
+        }
+    };
+
+    // inner is held by reference, it has to outlive the expression. With a memory_resource the result comes from it
+    template<class Inner, class FOuter, class FInner, class R, class Resource = void>
+    struct Join {
+        Inner const& inner;
+        FOuter outerFunction;
+        FInner innerFunction;
+        R resultFunction;
+        std::pmr::memory_resource* resource = nullptr;
+        explicit Join(Inner const& inner, FOuter&& outerFunc, FInner&& innerFunc, R&& resultFunc) requires (std::is_void_v<Resource>)
+            : inner(inner), outerFunction(outerFunc), innerFunction(innerFunc), resultFunction(resultFunc) {}
+        explicit Join(Inner const& inner, FOuter&& outerFunc, FInner&& innerFunc, R&& resultFunc, std::pmr::memory_resource* resource) requires (!std::is_void_v<Resource>)
+            : inner(inner), outerFunction(outerFunc), innerFunction(innerFunc), resultFunction(resultFunc), resource(resource) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            if constexpr (std::is_void_v<Resource>) return Sombrero::Linq::Join(std::forward<T>(range), inner, outerFunction, innerFunction, resultFunction);
+            else return Sombrero::Linq::Join(std::forward<T>(range), inner, outerFunction, innerFunction, resultFunction, resource);
+        }
+    };
+    template<class Inner, class FOuter, class FInner, class R>
+    Join(Inner const&, FOuter, FInner, R, std::pmr::memory_resource*) -> Join<Inner, FOuter, FInner, R, std::pmr::memory_resource>;
+
+    // Later Where, Select and terminal stages run on the thread pool, see Sombrero::Linq::ParallelQuery
+    struct AsParallel {
+        size_t degree;
+        explicit AsParallel(size_t degree = 0) : degree(degree) {}
+        template<class T>
+        requires (Sombrero::Linq::range<T>)
+        auto transform(T&& range) {
+            return Sombrero::Linq::AsParallel(std::forward<T>(range), degree);
+        }
+    };
+
+    // Only for the stages in this namespace, so std::views adaptors keep their own operator| on Linq ranges.
+    // Std views Linq can't read directly, like std::views::filter, are wrapped in a StdViewSource first
+    template<class T, class R>
+    requires (Sombrero::Linq::range<T> && requires (R& rhs, T&& inp) { rhs.transform(Sombrero::Linq::detail::AdaptSource(std::forward<T>(inp))); })
+    auto operator|(T&& inp, R&& rhs) {
+        // forwarded so stages that own their data, like ThenBy, can move it along
+        return rhs.transform(Sombrero::Linq::detail::AdaptSource(std::forward<T>(inp)));
+    }
+
     template<class T, class R>
-    requires (Sombrero::Linq::range<T>)
+    requires (Sombrero::Linq::parallel_query<T> && requires (R& rhs, T&& inp) { rhs.transform(std::forward<T>(inp)); })
     auto operator|(T&& inp, R&& rhs) {
-        return rhs.transform(inp);
+        return rhs.transform(std::forward<T>(inp));
     }
 }
\ No newline at end of file
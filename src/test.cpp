@@ -6,9 +6,29 @@
 #include "ColorUtils.hpp"
 #include "HSBColor.hpp"
 #include "RandomUtils.hpp"
+#include "RandomSampling.hpp"
+#include "SplineUtils.hpp"
+#include "TrailBuffer.hpp"
+#include "ParticleBuffer.hpp"
+#include "DampingUtils.hpp"
+#include "TransformHierarchy.hpp"
+#include "QuantizedUtils.hpp"
+#include "MotionStream.hpp"
+#include "NoiseUtils.hpp"
+#include "FrameArena.hpp"
+#include "Generator.hpp"
 #include "linq.hpp"
 #include "linq_functional.hpp"
 
+Sombrero::Generator<int> CountTo(int limit) {
+    for (int i = 0; i < limit; i++) co_yield i;
+}
+
+Sombrero::Generator<int> CountToTwice(int limit) {
+    co_yield CountTo(limit);
+    co_yield CountTo(limit);
+}
+
 int main() {
     Sombrero::FastVector3 vec3;
     Sombrero::vector3Str(vec3);
@@ -50,6 +70,62 @@ int main() {
     static_assert(val3 == 1.0f / 9.0f);
     static_assert(val4 == 1.0f / 125.0f);
 
+    Sombrero::FastVector3 path[] = {{0, 0, 0}, {0, 1, 2}, {1, 0, 4}, {0, 0, 6}};
+    auto spline = Sombrero::ArcLengthSpline::CatmullRom(path);
+    Sombrero::FastVector3 samples[8];
+    spline.SampleEvenly(samples);
+    Sombrero::FastQuaternion splineRotation = spline.GetRotationAtDistance(spline.get_length() * 0.5f);
+
+    static Sombrero::TrailBuffer<32> trail;
+    trail.Push(vec3, Sombrero::FastVector3::zero(), 0.0f);
+    std::span<Sombrero::TrailSample const> trailView = trail.Update();
+
+    Sombrero::ParticleBuffer particles(128);
+    particles.Emit(vec3, Sombrero::FastVector3::up(), Sombrero::FastColor::white(), 1.0f);
+    particles.Update(0.016f, {0.0f, -9.81f, 0.0f}, 0.5f, Sombrero::FastColor::white(), Sombrero::FastColor::clear());
+
+    Sombrero::FastVector3 dampVelocity;
+    vec3 = Sombrero::SmoothDamp(vec3, Sombrero::FastVector3::one(), dampVelocity, 0.3f, 0.016f);
+    Sombrero::CriticallyDampedSpring<Sombrero::FastQuaternion> rotationSpring(Sombrero::FastQuaternion::identity(), 12.0f);
+    rotationSpring.Update(splineRotation, 0.016f);
+
+    Sombrero::TransformHierarchy hierarchy;
+    auto root = hierarchy.Add(Sombrero::TransformHierarchy::NoParent, vec3);
+    auto child = hierarchy.Add(root, Sombrero::FastVector3::forward(), splineRotation);
+    Sombrero::FastVector3 childWorld = hierarchy.GetWorldPosition(child);
+
+    static_assert(Sombrero::HalfToFloat(Sombrero::FloatToHalf(0.5f)) == 0.5f);
+    Sombrero::FastVector3h halfVector(childWorld);
+    Sombrero::Vector3Quantizer quantizer({-10.0f, -10.0f, -10.0f}, {10.0f, 10.0f, 10.0f});
+    Sombrero::FixedVector3 fixedVector = quantizer.Pack(childWorld);
+    Sombrero::FastQuaternion packedRotation = Sombrero::PackedQuaternion32(splineRotation).Unpack();
+
+    Sombrero::MotionStreamReader replay("replay.smot");
+    std::vector<float> replayTimes;
+    std::vector<Sombrero::FastVector3> replayPositions;
+    std::vector<Sombrero::FastQuaternion> replayRotations;
+    replay.DecodeTimeRange(0.0f, 1.0f, replayTimes, replayPositions, replayRotations);
+
+    constexpr Sombrero::Noise noise(42);
+    float wobble = noise.Fractal(Sombrero::NoiseType::Simplex, vec3, 3);
+    float noiseOut[8];
+    noise.Sample<Sombrero::FastVector3>(Sombrero::NoiseType::Perlin, samples, noiseOut);
+
+    float randomValues[8];
+    Sombrero::RandomFast::Fill(randomValues, -1.0f, 1.0f);
+    int32_t randomIndex = Sombrero::RandomFast::randomInt(0, 8);
+    Sombrero::RandomStream randomStream(1234);
+    auto savedRandomState = randomStream.GetState();
+    auto workerStream = randomStream.Fork(3);
+    workerStream.Fill(randomValues, 0.0f, 10.0f);
+    randomStream.SetState(savedRandomState);
+
+    Sombrero::FastVector3 burst[16];
+    Sombrero::RandomGeometry::onUnitSphere(burst);
+    Sombrero::RandomGeometry::insideUnitSphere(randomStream, burst);
+    Sombrero::FastQuaternion spin = Sombrero::RandomGeometry::rotationUniform(randomStream);
+    Sombrero::FastColor sparkColor = Sombrero::RandomGeometry::ColorHSV(0.0f, 1.0f, 0.8f, 1.0f, 1.0f, 1.0f);
+
     using namespace Sombrero::Linq;
     ArrayW<int> a(5);
     for (auto item : Select(a, [](auto& v) {return float(v);})) {
@@ -71,4 +147,101 @@ int main() {
     }
 
     auto reverse = coll | Functional::Reverse();
+    // a Select over an array keeps random access, so these only project the elements they return
+    auto tenfold = a | Functional::Select([](int x) {return x * 10;});
+    auto lastTenfold = tenfold | Functional::Last();
+    auto thirdTenfold = tenfold | Functional::ElementAt(2);
+    for (auto item : Reverse(tenfold)) {
+        // iterate the products from the back
+    }
+    // counted without building the filtered result
+    auto bigCount = a | Functional::Where([](int x) {return x > 3;}) | Functional::Count();
+    // Where, Select and Take fuse into one loop
+    auto firstSquares = a | Functional::Where([](int x) {return x > 0;})
+                          | Functional::Select([](int x) {return x * x;})
+                          | Functional::Take(3);
+    int squareSum = firstSquares | Functional::Sum();
+    // stop reading the source as soon as possible
+    auto firstBig = Take(Where(a, [](int x) {return x > 3;}), 2) | Functional::ToVector();
+    auto leadingSmall = a | Functional::TakeWhile([](int x) {return x < 3;}) | Functional::Count();
+    for (auto block : a | Functional::Skip(1) | Functional::Chunk(2)) {
+        // block is a std::span of up to 2 elements
+    }
+    for (auto pair : a | Functional::Window(2)) {
+        // pair is a std::span of 2 neighbouring elements
+    }
+
+    int total = Sum(a);
+    auto smallest = a | Functional::Min();
+    std::span<Sombrero::FastVector3> pathSpan(path);
+    auto averageX = Average(pathSpan, [](Sombrero::FastVector3 const& point) { return point.x; });
+    Sombrero::FastVector3 center = *Average(pathSpan);
+    auto nearest = MinBy(pathSpan, [](Sombrero::FastVector3 const& point) { return point.sqrMagnitude(); });
+    int product = a | Functional::Aggregate(1, [](int acc, int v) { return acc * v; });
+
+    for (auto const& point : OrderBy(pathSpan, [](Sombrero::FastVector3 const& point) { return point.y; })
+                                | Functional::ThenByDescending([](Sombrero::FastVector3 const& point) { return point.z; })) {
+        // iterate the points from lowest to highest, furthest first on ties
+    }
+    auto closestTwo = Top(pathSpan, 2, [&](Sombrero::FastVector3 const& point) { return point.sqrDistance(center); });
+
+    auto parity = GroupBy(a, [](int v) { return v % 2; });
+    for (auto const& group : parity) {
+        // group.Key() is 0 or 1, iterate the values with that parity
+    }
+    auto evens = parity[0];
+    auto unique = a | Functional::Distinct();
+    auto visited = ToHashSet(pathSpan);
+    auto heightOf = ToDictionary(pathSpan, [](Sombrero::FastVector3 const& point) { return point; }, [](Sombrero::FastVector3 const& point) { return point.y; });
+    auto pairs = a | Functional::Join(a, [](int v) { return v; }, [](int v) { return v + 1; }, [](int outer, int inner) { return outer * inner; });
+
+    // walk several sources together or one after another without building anything in between
+    for (auto [point, value] : Zip(pathSpan, a)) {
+        // point and value are references into pathSpan and a
+    }
+    auto both = a | Functional::Concat(x);
+    auto thirdOfBoth = both[2];
+    auto flattened = parity | Functional::SelectMany([](auto const& group) -> auto const& { return group; }) | Functional::Count();
+
+    // per frame results come from an arena that is reset wholesale, so steady state frames don't touch the heap
+    static Sombrero::FrameArena frameArena;
+    frameArena.Reset();
+    auto frameEvens = a | Functional::Where([](int x) {return x % 2 == 0;}) | Functional::ToVector(&frameArena);
+    auto frameSet = ToHashSet(pathSpan, &frameArena);
+    auto frameGroups = a | Functional::GroupBy([](int x) {return x % 3;}, &frameArena);
+    std::pmr::memory_resource* noResource = nullptr;
+    auto heapOrdered = a | Functional::OrderBy([](int x) {return -x;}, noResource) | Functional::ToVector();
+
+    // short results stay on the stack
+    auto fewBig = a | Functional::Where([](int x) {return x > 3;}) | Functional::ToSmallVector<4>();
+    auto atMostTwo = a | Functional::Where([](int x) {return x < 0;}) | Functional::ToInplace<2>();
+    auto firstThree = a | Functional::Take(3) | Functional::ToStaticArray<3>();
+
+    auto lengths = AsParallel(pathSpan).Select([](Sombrero::FastVector3 const& point) { return point.Magnitude(); }).ToVector();
+    auto farCount = pathSpan | Functional::AsParallel(2)
+                             | Functional::Where([](Sombrero::FastVector3 const& point) { return point.sqrMagnitude() > 100.0f; })
+                             | Functional::Count();
+    // a temporary source moves into the query
+    auto ownedParallel = ToVector(pathSpan) | Functional::AsParallel() | Functional::Select([](Sombrero::FastVector3 const& point) { return point.x; });
+    auto ownedSum = ownedParallel.Sum();
+
+    // the projection runs once per element, however often labels is iterated
+    auto labels = a | Functional::Select([](int v) { return std::to_string(v); }) | Functional::Memoize();
+    for (auto const& label : labels) {}
+    auto labelCount = Count(labels);
+    auto shortLabels = SelectCached(a, [](int v) { return std::to_string(v); })
+                       | Functional::Where([](std::string const& label) { return label.size() < 2; })
+                       | Functional::ToVector();
+
+    // generated on the fly, no vector in between
+    auto generatedSquares = CountToTwice(5) | Functional::Where([](int v) { return v % 2 == 0; })
+                                           | Functional::Select([](int v) { return v * v; })
+                                           | Functional::ToVector();
+
+    // Linq ranges are std ranges, and std views feed into Linq
+    std::vector<int> scores{ 7, 2, 9, 4 };
+    auto topTwo = scores | Functional::Where([](int v) { return v > 3; }) | std::views::take(2);
+    std::ranges::sort(Reverse(std::span(scores)));
+    auto oddScores = scores | std::views::filter([](int v) { return v % 2 != 0; }) | Functional::Select([](int v) { return v * 10; }) | Functional::ToVector();
+    auto iotaSquares = std::views::iota(0) | Functional::Select([](int v) { return v * v; }) | Functional::Take(4) | Functional::ToVector();
 }